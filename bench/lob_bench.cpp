@@ -0,0 +1,332 @@
+#include "auction.hpp"
+#include "matching_engine.hpp"
+#include "sim.hpp"
+#include "strategies.hpp"
+#include "sweep.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+/*
+Microbenchmarks for the book, the matcher and the whole simulator, to
+track regressions across changes. Run with e.g.
+  ./build/lob_bench --benchmark_filter=Cancel --benchmark_min_time=0.5
+
+Book fixtures are described by three knobs, passed as benchmark args:
+  backend   0 = std::map levels, 1 = PriceLadder
+  spacing   ticks between adjacent levels: 1 = dense, 100 = sparse
+  per_level orders resting at each level: 1 = shallow, 100+ = deep
+
+Anything that would destroy the fixture (cancels, sweeps) works through a
+batch of operations per timed iteration and rebuilds with timing paused,
+so the pause/resume clock reads are spread over the batch.
+*/
+
+namespace {
+
+constexpr Price   kBase = 1000000;
+constexpr OrderId kIds  = 1'000'000'000ull; // away from the engine's own ids
+
+BookBackend backend_arg(int64_t a) { return a ? BookBackend::Ladder : BookBackend::Map; }
+
+Order limit(OrderId id, Side s, Price px, Qty q) { return {id, s, OrdType::Limit, px, q, 0.0}; }
+
+// `levels` bid levels below kBase and as many asks above, `spacing` ticks
+// apart, `per_level` orders of qty 1 each. Returns the next free id.
+OrderId fill_book(OrderBook& ob, int levels, Price spacing, int per_level, OrderId id = kIds) {
+  for (int l = 0; l < levels; ++l) {
+    for (int k = 0; k < per_level; ++k) {
+      ob.add_limit(limit(id++, Side::Buy,  kBase - 1 - l * spacing, 1));
+      ob.add_limit(limit(id++, Side::Sell, kBase + 1 + l * spacing, 1));
+    }
+  }
+  return id;
+}
+
+// Adds into a populated book, at prices drawn over the fixture's levels
+void BM_AddLimit(benchmark::State& st) {
+  const Price spacing = st.range(1);
+  const int   levels = 1000, batch = 1024;
+  OrderBook ob(backend_arg(st.range(0)));
+  OrderId id = fill_book(ob, levels, spacing, int(st.range(2)));
+
+  std::mt19937_64 rng(1);
+  std::vector<Order> orders;
+  for (int i = 0; i < batch; ++i) {
+    const Side s = (i & 1) ? Side::Buy : Side::Sell;
+    const Price off = 1 + Price(rng() % levels) * spacing;
+    orders.push_back(limit(0, s, s == Side::Buy ? kBase - off : kBase + off, 1));
+  }
+
+  for (auto _ : st) {
+    const OrderId first = id;
+    for (Order& o : orders) { o.id = id++; ob.add_limit(o); }
+    st.PauseTiming();
+    for (OrderId k = first; k < id; ++k) ob.cancel(k);
+    st.ResumeTiming();
+  }
+  st.SetItemsProcessed(st.iterations() * batch);
+}
+BENCHMARK(BM_AddLimit)->ArgNames({"ladder", "spacing", "per_level"})
+    ->ArgsProduct({{0, 1}, {1, 100}, {1, 100}});
+
+// Cancels of a block of orders at a given queue position (0 = front,
+// 50 = middle, 100 = back) of one level holding `depth` orders
+void BM_CancelAt(benchmark::State& st) {
+  const int pos = int(st.range(1)), depth = int(st.range(2)), batch = 256;
+  OrderBook ob(backend_arg(st.range(0)));
+  std::vector<OrderId> fifo;          // the level's queue, front first
+  OrderId id = kIds;
+  for (int i = 0; i < depth; ++i) {
+    ob.add_limit(limit(id, Side::Sell, kBase, 1));
+    fifo.push_back(id++);
+  }
+  ob.add_limit(limit(id++, Side::Buy, kBase - 1, 1)); // keep a bid side
+
+  const std::size_t at = std::size_t(pos) * std::size_t(depth - batch) / 100;
+  for (auto _ : st) {
+    for (int k = 0; k < batch; ++k) ob.cancel(fifo[at + k]);
+    st.PauseTiming();
+    // re-add the block at the back and mirror that in fifo
+    fifo.erase(fifo.begin() + at, fifo.begin() + at + batch);
+    for (int k = 0; k < batch; ++k) {
+      ob.add_limit(limit(id, Side::Sell, kBase, 1));
+      fifo.push_back(id++);
+    }
+    st.ResumeTiming();
+  }
+  st.SetItemsProcessed(st.iterations() * batch);
+}
+BENCHMARK(BM_CancelAt)->ArgNames({"ladder", "pos", "depth"})
+    ->ArgsProduct({{0, 1}, {0, 50, 100}, {1000, 100000}});
+
+// A market buy that clears exactly `n` ask levels of `per_level` orders.
+// The asks hold kSweeps such bands back to back, refilled when used up.
+void BM_MarketSweep(benchmark::State& st) {
+  constexpr int kSweeps = 64;
+  const int n = int(st.range(1)), per_level = int(st.range(2));
+  const Price spacing = st.range(3);
+  OrderBook ob(backend_arg(st.range(0)));
+  MatchingEngine me(ob);
+  OrderId id = kIds;
+  ob.add_limit(limit(id++, Side::Buy, kBase - 1, 1));
+  auto refill = [&] {
+    for (int l = 0; l < n * kSweeps; ++l)
+      for (int k = 0; k < per_level; ++k) ob.add_limit(limit(id++, Side::Sell, kBase + 1 + l * spacing, 1));
+  };
+  uint64_t fills = 0;
+  auto count = [&](const Fill&) { ++fills; };
+
+  refill();
+  int left = kSweeps;
+  for (auto _ : st) {
+    if (left == 0) {
+      st.PauseTiming();
+      refill();
+      left = kSweeps;
+      st.ResumeTiming();
+    }
+    me.submit_market(Side::Buy, Qty(n) * per_level, 0.0, count);
+    --left;
+  }
+  benchmark::DoNotOptimize(fills);
+  st.SetItemsProcessed(st.iterations() * n); // levels cleared
+  st.counters["makers_per_sweep"] = double(n) * per_level;
+}
+BENCHMARK(BM_MarketSweep)->ArgNames({"ladder", "levels", "per_level", "spacing"})
+    ->ArgsProduct({{0, 1}, {1, 10, 100}, {1, 10}, {1, 100}});
+
+// Cost per maker of sweeping the front of one deep level: with O(1) pops
+// it should not depend on how many orders wait behind the sweep
+void BM_SweepDeepLevel(benchmark::State& st) {
+  const std::size_t depth = std::size_t(st.range(0));
+  const Qty sweep = 200;
+  OrderBook ob;
+  MatchingEngine me(ob);
+  OrderId id = kIds;
+  auto count = [](const Fill&) {};
+  for (auto _ : st) {
+    st.PauseTiming();
+    // top the level back up so every sweep sees `depth` resting orders
+    while (ob.index.size() < depth) ob.add_limit(limit(id++, Side::Sell, 100, 1));
+    st.ResumeTiming();
+    me.submit_market(Side::Buy, sweep, 0.0, count);
+  }
+  st.SetItemsProcessed(st.iterations() * sweep); // makers
+}
+BENCHMARK(BM_SweepDeepLevel)->ArgName("depth")->Arg(200)->Arg(1000)->Arg(10000)->Arg(100000);
+
+// Book memory per resting order (node pool, resting list, index, levels)
+// for `orders` orders over 500 levels a side, built from empty each time
+void BM_BookFootprint(benchmark::State& st) {
+  const int n = int(st.range(1));
+  double per_order = 0.0;
+  for (auto _ : st) {
+    OrderBook ob(backend_arg(st.range(0)));
+    const uint64_t empty = ob.arena.bytes_live();
+    ob.reserve(std::size_t(n));
+    OrderId id = kIds;
+    for (int k = 0; k < n; ++k) {
+      const Price off = 1 + (k / 2) % 500;
+      ob.add_limit(k % 2 ? limit(id++, Side::Sell, kBase + off, 1) : limit(id++, Side::Buy, kBase - off, 1));
+    }
+    per_order = double(ob.arena.bytes_live() - empty) / n;
+  }
+  st.SetItemsProcessed(st.iterations() * n);
+  st.counters["bytes_per_order"] = per_order;
+}
+BENCHMARK(BM_BookFootprint)->ArgNames({"ladder", "orders"})
+    ->ArgsProduct({{0, 1}, {100000, 1000000}})->Unit(benchmark::kMillisecond);
+
+// Read-only impact query for a market order that would clear about
+// `levels` levels of `per_level` orders (qty 1 each)
+void BM_EstimateImpact(benchmark::State& st) {
+  OrderBook ob(backend_arg(st.range(0)));
+  const int per_level = int(st.range(3));
+  fill_book(ob, 1000, st.range(2), per_level);
+  const Qty q = st.range(1) * per_level;
+  int i = 0;
+  for (auto _ : st) {
+    benchmark::DoNotOptimize(ob.estimate_impact((++i & 1) ? Side::Buy : Side::Sell, q));
+  }
+  st.SetItemsProcessed(st.iterations());
+}
+BENCHMARK(BM_EstimateImpact)->ArgNames({"ladder", "levels", "spacing", "per_level"})
+    ->ArgsProduct({{0, 1}, {1, 10, 100}, {1, 100}, {1, 10}});
+
+// The same `n` limit orders, priced within 5 ticks either side of mid so
+// that about half of them cross, matched continuously (one submit_limit
+// each) or collected and uncrossed in one call auction. What rests
+// afterwards is cancelled with timing paused, so every batch meets an
+// empty book.
+void BM_MatchBatch(benchmark::State& st) {
+  const bool auction = st.range(1) != 0;
+  const int  n = int(st.range(2));
+  OrderBook ob(backend_arg(st.range(0)));
+  MatchingEngine me(ob);
+  CallAuction au(ob, me);
+
+  std::mt19937_64 rng(1);
+  std::vector<Order> orders;
+  for (int i = 0; i < n; ++i) {
+    const Side s = (rng() & 1) ? Side::Buy : Side::Sell;
+    orders.push_back(limit(0, s, kBase - 5 + Price(rng() % 11), Qty(1 + rng() % 10)));
+  }
+  uint64_t fills = 0;
+  auto count = [&](const Fill&) { ++fills; };
+
+  for (auto _ : st) {
+    const OrderId first = me.next_order_id();
+    if (auction) {
+      for (const Order& o : orders) au.limit(o.side, o.limit_price, o.qty, 0.0);
+      au.uncross(0.0, count);
+    } else {
+      for (const Order& o : orders) me.submit_limit(o.side, o.limit_price, o.qty, 0.0, count);
+    }
+    st.PauseTiming();
+    for (OrderId k = first; k < me.next_order_id(); ++k) ob.cancel(k);
+    st.ResumeTiming();
+  }
+  benchmark::DoNotOptimize(fills);
+  st.SetItemsProcessed(st.iterations() * n);   // orders
+  st.counters["fills_per_batch"] = double(fills) / double(st.iterations());
+}
+BENCHMARK(BM_MatchBatch)->ArgNames({"ladder", "auction", "orders"})
+    ->ArgsProduct({{0, 1}, {0, 1}, {100, 1000, 10000}});
+
+// Whole simulator with the flow matched in periodic call auctions, every
+// `us` sim microseconds (0 = continuous, as BM_SimEndToEnd)
+void BM_SimAuction(benchmark::State& st) {
+  SimConfig sc = m3_sweep_base(BookBackend::Ladder);
+  sc.auction_interval = double(st.range(0)) * 1e-6;
+  uint64_t trades = 0;
+  for (auto _ : st) {
+    Simulator sim(sc);
+    trades += sim.simulate().trades;
+  }
+  benchmark::DoNotOptimize(trades);
+  st.SetItemsProcessed(st.iterations() * int64_t(sc.max_events));
+}
+BENCHMARK(BM_SimAuction)->ArgName("us")->Arg(0)->Arg(100)->Arg(1000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_BestBid(benchmark::State& st) {
+  OrderBook ob(backend_arg(st.range(0)));
+  fill_book(ob, 1000, st.range(1), 1);
+  for (auto _ : st) benchmark::DoNotOptimize(ob.best_bid());
+}
+BENCHMARK(BM_BestBid)->ArgNames({"ladder", "spacing"})->ArgsProduct({{0, 1}, {1, 100}});
+
+void BM_Mid(benchmark::State& st) {
+  OrderBook ob(backend_arg(st.range(0)));
+  fill_book(ob, 1000, st.range(1), 1);
+  for (auto _ : st) benchmark::DoNotOptimize(ob.mid());
+}
+BENCHMARK(BM_Mid)->ArgNames({"ladder", "spacing"})->ArgsProduct({{0, 1}, {1, 100}});
+
+// Whole simulator, M3 model: generation, resolve, matching and telemetry
+void BM_SimEndToEnd(benchmark::State& st) {
+  SimConfig sc = m3_sweep_base(backend_arg(st.range(0)), st.range(1) ? RngKind::Philox : RngKind::Xoshiro);
+  sc.pipeline = st.range(2) != 0;
+  uint64_t trades = 0;
+  for (auto _ : st) {
+    Simulator sim(sc);
+    trades += sim.simulate().trades;
+  }
+  benchmark::DoNotOptimize(trades);
+  st.SetItemsProcessed(st.iterations() * int64_t(sc.max_events)); // events/sec
+}
+BENCHMARK(BM_SimEndToEnd)->ArgNames({"ladder", "philox", "pipeline"})
+    ->ArgsProduct({{0, 1}, {0, 1}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// Same run with no observer: what the telemetry costs is the difference
+void BM_SimBare(benchmark::State& st) {
+  const SimConfig sc = m3_sweep_base(backend_arg(st.range(0)));
+  uint64_t events = 0;
+  for (auto _ : st) {
+    BareSimulator sim(sc);
+    events += sim.simulate().events;
+  }
+  benchmark::DoNotOptimize(events);
+  st.SetItemsProcessed(st.iterations() * int64_t(sc.max_events));
+}
+BENCHMARK(BM_SimBare)->ArgName("ladder")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Forking a run from a warmed-up checkpoint: Simulator construction plus
+// restore, i.e. what replaces the warm-up's `warmup` events
+void BM_CheckpointFork(benchmark::State& st) {
+  SimConfig sc = m3_sweep_base(backend_arg(st.range(0)));
+  sc.max_events = std::size_t(st.range(1));
+  Simulator warm(sc);
+  warm.simulate();
+  const Checkpoint ck = warm.checkpoint();
+  for (auto _ : st) {
+    Simulator sim(sc);
+    sim.restore(ck, Resume::Fork);
+    benchmark::DoNotOptimize(sim.book().resting());
+  }
+  st.counters["resting"] = double(ck.header().orders);
+}
+BENCHMARK(BM_CheckpointFork)->ArgNames({"ladder", "warmup"})
+    ->ArgsProduct({{0, 1}, {50000, 200000}})->Unit(benchmark::kMicrosecond);
+
+// Same run with `n` quoting makers attached: the cost of the agent layer
+void BM_SimAgents(benchmark::State& st) {
+  const SimConfig sc = m3_sweep_base(BookBackend::Ladder);
+  const auto n = std::size_t(st.range(0));
+  uint64_t events = 0;
+  for (auto _ : st) {
+    AgentSet<QuotingMaker> agents;
+    for (std::size_t k = 0; k < n; ++k) agents.add<QuotingMaker>(10, Price(1 + k % 5), 2, 500);
+    Simulator sim(sc);
+    sim.attach(agents);
+    events += sim.simulate().events;
+  }
+  benchmark::DoNotOptimize(events);
+  st.SetItemsProcessed(st.iterations() * int64_t(sc.max_events));
+}
+BENCHMARK(BM_SimAgents)->ArgName("agents")->Arg(1)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
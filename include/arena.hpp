@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+/*
+Per-book memory arena.
+
+Book containers (level maps, ladder arrays, id index, node pool) all
+allocate from one pool resource. Freed blocks go back on a
+per-size free list and are handed out again before any new chunk is
+requested, so once a run reaches steady state nothing reaches malloc.
+
+Everything the pool requests from the system goes through a counting
+resource; allocations() is the number of real malloc calls so far.
+*/
+class CountingResource : public std::pmr::memory_resource {
+public:
+  explicit CountingResource(std::pmr::memory_resource* upstream) : upstream_(upstream) {}
+
+  uint64_t allocations() const { return allocs_; }
+  uint64_t bytes_live()  const { return bytes_live_; }
+  uint64_t bytes_peak()  const { return bytes_peak_; }
+
+private:
+  std::pmr::memory_resource* upstream_;
+  uint64_t allocs_{0};
+  uint64_t bytes_live_{0};
+  uint64_t bytes_peak_{0};
+
+  void* do_allocate(std::size_t bytes, std::size_t align) override {
+    void* p = upstream_->allocate(bytes, align);
+    ++allocs_;
+    bytes_live_ += bytes;
+    if (bytes_live_ > bytes_peak_) bytes_peak_ = bytes_live_;
+    return p;
+  }
+  void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+    upstream_->deallocate(p, bytes, align);
+    bytes_live_ -= bytes;
+  }
+  bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+    return this == &o;
+  }
+};
+
+class Arena {
+public:
+  Arena() : counter_(std::pmr::new_delete_resource()), pool_(&counter_) {}
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  std::pmr::memory_resource* resource() { return &pool_; }
+
+  uint64_t allocations() const { return counter_.allocations(); } // upstream (malloc) calls
+  uint64_t bytes_live()  const { return counter_.bytes_live(); }
+  uint64_t bytes_peak()  const { return counter_.bytes_peak(); }
+
+private:
+  CountingResource                       counter_;
+  std::pmr::unsynchronized_pool_resource pool_;   // size-class free lists, single thread
+};
@@ -0,0 +1,184 @@
+#pragma once
+#include "matching_engine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Call auctions: orders are collected during a call phase and matched all
+at once, at one price, instead of one at a time as they arrive. For
+opening / closing auctions, and for periodic batch auctions (uncross
+every so many microseconds of flow).
+
+Collected orders wait in the auction, not in the book, so the book stays
+uncrossed (and its quotes mean what they say) through the call; a
+collected order can be cancelled here until the uncross. Orders already
+resting in the book take part in the uncross too, ahead of collected
+orders at the same price (they were there first).
+
+uncross() works off aggregates. Collected limits are bucketed by price,
+and each side's curve (market orders first, then price levels
+best-first, a level being the book's queue there plus the collected
+orders) is paired against the other's, level by level, while the two
+still cross. That is one pass over the crossed part of each curve, and
+the qty paired is the most that can trade at any single price. Every
+price between the last ask level and the last bid level used trades
+that much; the one closest to `ref` is taken (the middle of the range if
+ref is 0). One side usually has more at its marginal level than it can
+get; that level is shared out by Allocation, every better level (and
+every market order, unless the markets themselves are marginal) fills
+in full. What is left of collected limits then rests in the book, in
+arrival order; what is left of market orders is dropped, as in
+continuous matching.
+
+Fills go to a sink as in MatchingEngine, all at the auction price. There
+is no aggressor in an auction, so each fill names the later of its two
+orders (the higher id) the taker, and carries both orders' tags as they
+are at that fill. As there, the sink must not add or cancel orders.
+Resting orders only go down in place, so one left over after the
+uncross keeps its time priority.
+
+Per order, the call phase is an append and the uncross a bucket pass
+plus its share of the fills; only what is left gets added to the book.
+N orders matched continuously pay a match attempt each as well, plus
+the adds for everything that rests along the way.
+*/
+
+enum class Allocation : uint8_t {
+  TimePriority,  // the marginal level fills front to back
+  ProRata        // in proportion to each order's qty; rounding leftovers front to back
+};
+
+struct AuctionResult {
+  Price    price  = 0;   // uncrossing price (0: nothing crossed)
+  Qty      volume = 0;   // traded, on each side
+  uint32_t fills  = 0;
+};
+
+// An order collected for the next uncross
+struct CallOrder {
+  OrderId   id;
+  Price     px;    // 0: market order
+  Qty       qty;   // still to trade (0: cancelled)
+  TimePoint ts;
+  Side      side;
+  int8_t    tag;   // rests with the order, as MatchingEngine::submit_limit's
+};
+
+class CallAuction {
+public:
+  CallAuction(OrderBook& ob, MatchingEngine& me, Allocation alloc = Allocation::TimePriority)
+    : book_(ob), me_(me), alloc_(alloc) {}
+
+  // Call phase; ids come from the engine, like any other order's.
+  // std::invalid_argument for a qty or price <= 0.
+  OrderId limit(Side s, Price px, Qty q, TimePoint t, int8_t tag = -1);
+  OrderId market(Side s, Qty q, TimePoint t);
+  // Withdraw a collected order; false if it is not (or no longer) collected
+  bool cancel(OrderId id);
+  // A collected order by id, nullptr if there is none; a sink may clear
+  // its tag, as it can a resting order's
+  CallOrder* find(OrderId id);
+
+  // Price and volume an uncross would give right now; touches nothing.
+  // fills is not known before the allocation and stays 0.
+  AuctionResult indicative(Price ref = 0) const;
+
+  // Match everything that crosses at one price (see above), then rest
+  // what is left of the collected limits; the call starts over empty
+  template <class Sink>
+  AuctionResult uncross(TimePoint t, Sink&& sink, Price ref = 0);
+  AuctionResult uncross(TimePoint t, std::vector<Fill>& out, Price ref = 0);
+
+  std::size_t collected() const { return calls_.size(); }   // cancelled ones included
+  Allocation  allocation() const { return alloc_; }
+
+private:
+  // One price of a curve: the book's queue there, then the collected orders
+  struct Level {
+    Price    px;            // 0: the market orders
+    Qty      qty;           // book + collected
+    Qty      book_qty;
+    Qty      book_taken;    // set by allocate
+    uint32_t first, last;   // collected orders at px: sorted_[first, last)
+  };
+  // One order's share of the volume, in priority order
+  struct Take {
+    OrderId id;
+    Qty     qty;
+    Qty*    left;     // the order's qty, in the book or in calls_
+    int8_t* tag;
+    bool    resting;  // in the book
+  };
+
+  // Collected orders into sorted_: the buys, then the sells (see
+  // side_end_), each side's markets first, then its limits best price
+  // first, arrival order within a price; cancelled ones last
+  void sort_calls() const;
+  // Both curves into curve_ (crossed part only), then the pairing pass;
+  // price 0 if nothing trades
+  AuctionResult discover(Price ref) const;
+  // Share `volume` out over side s's curve into takes_[s]
+  void allocate(Side s, Qty volume);
+  void share(std::vector<Take>& level, Qty level_qty, Qty want, std::vector<Take>& out) const;
+  // Settle side s's traded book levels; rest the collected remainder
+  void settle(Side s);
+  void rest_remainder();
+
+  OrderBook&      book_;
+  MatchingEngine& me_;
+  Allocation      alloc_;
+  std::vector<CallOrder> calls_;           // arrival order, so ascending ids
+
+  // scratch, reused across uncrosses
+  mutable std::vector<uint32_t>   sorted_;      // indices into calls_
+  mutable uint32_t                side_end_[2] = {0, 0};
+  mutable std::vector<uint32_t>   count_;       // bucket sort
+  mutable std::vector<Level>      curve_[2];
+  mutable std::vector<DepthLevel> book_levels_;
+  std::vector<Take> takes_[2];
+  std::vector<Take> level_;
+};
+
+// ---- template definitions ----
+
+template <class Sink>
+AuctionResult CallAuction::uncross(TimePoint t, Sink&& sink, Price ref) {
+  if (calls_.empty()) return {};   // the book alone never crosses
+  AuctionResult r = discover(ref);
+  if (r.volume > 0) {
+    allocate(Side::Buy,  r.volume);
+    allocate(Side::Sell, r.volume);
+
+    // Pair the two allocations in priority order. Executions come off the
+    // orders' qty in place, right after the sink has seen the fill (so it
+    // sees both orders as they were before it, as with the matcher's
+    // makers); book levels are settled once every fill is out.
+    const std::vector<Take>& buys  = takes_[int(Side::Buy)];
+    const std::vector<Take>& sells = takes_[int(Side::Sell)];
+    std::size_t i = 0, j = 0;
+    Qty bl = buys.empty()  ? 0 : buys[0].qty;
+    Qty sl = sells.empty() ? 0 : sells[0].qty;
+    while (i < buys.size() && j < sells.size()) {
+      const Take& b = buys[i];
+      const Take& s = sells[j];
+      const Qty x = std::min(bl, sl);
+      const bool buyer_later = b.id > s.id;
+      const Take& taker = buyer_later ? b : s;
+      const Take& maker = buyer_later ? s : b;
+      sink(Fill{ taker.id, maker.id, buyer_later ? Side::Buy : Side::Sell,
+                 r.price, x, t, *maker.tag, *taker.tag });
+      ++r.fills;
+      *b.left -= x;
+      *s.left -= x;
+      bl -= x;
+      sl -= x;
+      if (bl == 0 && ++i < buys.size())  bl = buys[i].qty;
+      if (sl == 0 && ++j < sells.size()) sl = sells[j].qty;
+    }
+    settle(Side::Buy);
+    settle(Side::Sell);
+  }
+  rest_remainder();
+  return r;
+}
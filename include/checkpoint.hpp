@@ -0,0 +1,97 @@
+#pragma once
+#include "event_gen.hpp"
+#include "event_log.hpp"      // LogHeader
+#include "mapped_file.hpp"
+#include "matching_engine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+/*
+Checkpoints: the state of a simulated market at one instant, so runs can
+start from a warmed-up book instead of burning through the warm-up.
+
+What is saved is what the next event depends on: every resting order
+(in time priority, plus the order of the book's resting list, which is
+what cancels sample from), the engine's next order id, sim time, the
+regime and the generator's clocks and raw draw state. Telemetry, logs
+and agents are not: a restored run measures from the checkpoint on.
+
+On disk, all native-endian:
+
+  LogHeader          magic "LOBCKPT1", record_size = sizeof(RestingRecord)
+  CheckpointHeader   fixed size, see below
+  RestingRecord[n]   bids best price first, then asks; each level front
+                     to back
+  OrderId[n]         the resting list, slot 0 first
+
+Everything is fixed-size and 8-byte aligned, so a loaded checkpoint is
+the mapped file itself: nothing is parsed or copied until a Simulator
+restores from it, and one Checkpoint can seed any number of runs (on
+any number of threads, it is read-only).
+*/
+
+struct RestingRecord {
+  OrderId   id;
+  Price     px;
+  Qty       qty;
+  TimePoint ts;
+  Side      side;
+  uint8_t   pad[7];
+};
+static_assert(sizeof(RestingRecord) == 40, "RestingRecord is 40 bytes on disk");
+
+struct CheckpointHeader {
+  uint64_t  seed;         // config the state was drawn under
+  uint32_t  stream;
+  RngKind   rng;
+  Regime    regime;       // regime of the last event
+  uint8_t   pad[2];
+  uint64_t  events;       // events executed to get here
+  OrderId   next_id;      // MatchingEngine::next_order_id
+  TimePoint t;            // sim time of the last event
+  uint64_t  orders;       // resting orders
+  EventGenerator::State gen;
+};
+static_assert(sizeof(CheckpointHeader) % 8 == 0, "records after the header stay 8-byte aligned");
+
+// How a restored Simulator draws on (see BasicSimulator::restore)
+enum class Resume : uint8_t { Continue, Fork };
+
+inline constexpr char kCheckpointMagic[8] = {'L','O','B','C','K','P','T','1'};
+
+class Checkpoint {
+public:
+  // Snapshot of a book and its engine. h carries what only the caller
+  // knows (config, sim time, regime, generator); next_id and orders are
+  // taken from me and ob.
+  Checkpoint(const CheckpointHeader& h, const OrderBook& ob, const MatchingEngine& me);
+  // Map a checkpoint file; std::runtime_error if it is not one (or is cut short)
+  explicit Checkpoint(const std::string& path);
+
+  Checkpoint(Checkpoint&&) = default;
+  Checkpoint& operator=(Checkpoint&&) = default;
+
+  void save(const std::string& path) const;   // std::runtime_error on I/O errors
+
+  const CheckpointHeader&        header()  const { return *header_; }
+  std::span<const RestingRecord> orders()  const { return {orders_, std::size_t(header_->orders)}; }
+  std::span<const OrderId>       resting() const { return {resting_, std::size_t(header_->orders)}; }
+
+  // Rebuild the book (which must be empty) and the engine's ids from this
+  // checkpoint; std::logic_error if the book is not empty
+  void restore(OrderBook& ob, MatchingEngine& me) const;
+
+private:
+  void point_into(const uint8_t* p);   // set the views over one image
+
+  std::vector<uint8_t>        bytes_;  // image built in memory, or
+  std::unique_ptr<MappedFile> file_;   // the mapped file
+
+  const CheckpointHeader* header_  = nullptr;
+  const RestingRecord*    orders_  = nullptr;
+  const OrderId*          resting_ = nullptr;
+};
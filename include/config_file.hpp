@@ -0,0 +1,54 @@
+#pragma once
+#include "sim_config.hpp"
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+/*
+SimConfig as text: config files, and `key=value` overrides from the
+command line.
+
+One setting per line, `key = value`. Blank lines and anything after a
+'#' are ignored. Keys are the SimConfig members, nested ones dotted as
+in code:
+
+  seed              = 7
+  max_events        = 1000000000
+  book_backend      = ladder
+  regime.low.lambda = 800
+  regime.high.mix.p_mkt_buy = 0.18
+  max_resting       = 2000000        # bounded memory
+
+Enums go by name: book_backend map | ladder, rng xoshiro | philox,
+pipeline_wait spin | yield | park, trade_log_format text | binary,
+trade_log_policy block | drop, auction_allocation time | pro-rata.
+Booleans are true | false. There is no p_cancel key: cancels are
+whatever the other four probabilities of a regime's mix leave.
+
+Numbers are range-checked as they are set: probabilities (p_LL, p_HH,
+the mix, keep_cross_prob) in [0, 1], geolap_alpha in (0, 1], rates,
+sizes and counts (lambda, gen_batch, pipeline_ring, mean qtys, ...)
+> 0, and limits where 0 means off (max_offset_ticks, max_resting,
+auction_interval, ...) >= 0. Constraints across keys, such as the four
+probabilities of a mix summing to at most 1, are the Simulator's to
+check when it is built.
+
+Settings apply in order onto a config that already holds defaults, so a
+file only lists what it changes and a later setting wins. write_config
+prints every key, in a form load_config reads back to the same config
+(doubles round-trip exactly).
+*/
+
+// Set one field; std::invalid_argument for an unknown key or a value
+// that does not parse as the field's type
+void set_config(SimConfig& c, std::string_view key, std::string_view value);
+// Same, from one "key=value"
+void set_config(SimConfig& c, std::string_view assignment);
+
+// Every setting in the file at path, in order. std::runtime_error if it
+// cannot be read, std::invalid_argument (naming file and line) for a bad
+// line; settings before a bad line stay applied.
+void load_config(SimConfig& c, const std::string& path);
+
+// All keys and their values, one per line, in the file format
+void write_config(std::ostream& os, const SimConfig& c);
@@ -0,0 +1,186 @@
+#pragma once
+#include "sim_config.hpp"
+#include "rng.hpp"
+#include "scheduler.hpp"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+/*
+Book-independent half of event generation.
+
+Everything about an event that does not depend on the book is drawn
+ahead of time, a batch at a time, into columns (structure of arrays):
+arrival time, regime path, event type, side, qty, signed tick offset and
+one spare uniform (kept as a 32-bit fraction, as it travels in
+SimEvent). The simulator then resolves each row against the live book
+(where is mid, does the price cross, which resting order to cancel).
+
+Arrivals run in continuous time. Each event type is its own Poisson
+process, at rate lambda * p_type of the regime in force, and the regime
+is a two-state Markov process in time, leaving regime r at rate
+lambda_r * (1 - p_stay_r): the same mean number of events per regime
+spell as a per-event switch with probability 1 - p_stay. An
+EventScheduler races the six clocks; the earliest type clock to ring is
+the next event, and its time is the event's timestamp. On a regime
+switch the pending clocks are not redrawn: each keeps its unspent share
+of an Exp(1) hazard budget and is rescaled to the new rate, which is
+exact for exponentials and costs no draws.
+
+Each event consumes exactly kWordsPerEvent raw 64-bit draws, in order,
+so the whole stream is a function of the seed alone: batch size, and
+how the book evolves, never shift which draws an event gets. (A regime
+switch landing before an event takes its holding time from that event's
+word 0, further switches before the same event from a splitmix64 chain
+on it.)
+
+Two raw sources are available (SimConfig::rng):
+  - Xoshiro: one sequential stream from the seed. Fast, but event i's
+    draws are only reachable by generating events 0..i-1 first.
+  - Philox: event i's words are Philox4x32-10 of the counter
+    (i, block, stream) under key = seed. Any event can be recomputed on
+    its own, so batches can be drawn out of order or on other threads,
+    and a run can be resumed or split at any event index and still match
+    the serial run draw for draw.
+
+The clocks and the regime are the one carried dependency: with Philox
+they are cheap to replay (two blocks per event), which is what
+seek(event) does.
+*/
+struct EventBatch {
+  std::vector<int64_t>   ts_ns;   // arrival time, sim nanoseconds
+  std::vector<Regime>    regime;  // regime the event was drawn in
+  std::vector<EventType> type;
+  std::vector<Side>      side;    // Cancel: side of the fallback limit
+  std::vector<uint32_t>  qty;     // Cancel: qty of the fallback limit
+  std::vector<int32_t>   offset;  // signed ticks from mid (limits and fallback)
+  std::vector<uint32_t>  pick;    // uniform (2^-32 units); limits: keep-cross coin; Cancel: which resting order
+  std::size_t            n = 0;   // rows filled
+
+  void resize(std::size_t rows);
+  // Row i as an unresolved packed event (see SimEvent)
+  SimEvent row(std::size_t i) const {
+    SimEvent e;
+    e.ts_ns  = ts_ns[i];
+    e.draw   = {offset[i], pick[i]};
+    e.qty    = qty[i];
+    e.type   = type[i];
+    e.side   = side[i];
+    e.regime = regime[i];
+    return e;
+  }
+};
+
+/*
+A regime path on its own clock: the same two-state process in time as a
+generator's regime (leaving r at rate lambda_r * (1 - p_stay_r)), drawn
+from its own key, with no events attached. The market-wide regime of a
+multi-symbol run (multi_sim.hpp): symbols at different sim times each
+read it at their own time.
+
+Switch k's holding time is Philox(key, k), so at(t) depends on the key
+and t alone, not on who asks first or how often. The path is drawn
+lazily up to the latest t asked for; forget_before(t) drops the
+switches no caller will read again, which keeps it small.
+*/
+class RegimePath {
+public:
+  RegimePath(const SimConfig& cfg, uint64_t key);
+
+  Regime at(TimePoint t);             // t >= the last forget_before
+  void   forget_before(TimePoint t);
+
+private:
+  uint64_t       key_;
+  double         rate_[2];             // switch rate out of each regime
+  EventScheduler clock_{1};            // the next switch
+  uint64_t       drawn_{0};            // switches drawn so far
+  Regime         last_{Regime::Low};   // regime after the last switch drawn
+  Regime         first_{Regime::Low};  // regime before switches_.front()
+  std::deque<TimePoint> switches_;     // drawn and not forgotten, ascending
+
+  void schedule_next(TimePoint from);
+};
+
+class EventGenerator {
+public:
+  // raw draws per event: regime holding time, spare, qty, |offset|,
+  // sign/side bits, u, inter-arrival time, regime-follow coin
+  static constexpr std::size_t kWordsPerEvent = 8;
+
+  // Scheduler processes: one arrival clock per EventType, then the regime switch
+  static constexpr std::size_t kTypes = 5;
+  static constexpr EventScheduler::Id kRegimeClock = kTypes;
+  static constexpr std::size_t kProcesses = kTypes + 1;
+
+  explicit EventGenerator(const SimConfig& cfg);
+
+  // Draw the next n events into b (rows [0, n))
+  void fill(EventBatch& b, std::size_t n);
+
+  // Same, with the regime coupled to a common path: before each row, with
+  // probability `follow` (raw word 7), the regime is set to the common
+  // one at the generator's time (clocks rescaled as for any switch);
+  // otherwise only its own clock moves it. follow = 0 gives exactly
+  // fill(b, n).
+  void fill(EventBatch& b, std::size_t n, RegimePath* common, double follow);
+
+  // Continue from event index `event`, recovering the clocks and regime by
+  // replaying the (uncoupled) process from event 0. Philox only; throws
+  // std::logic_error otherwise.
+  void seek(uint64_t event);
+
+  // Start the clocks afresh (new budgets from this generator's seed) at
+  // time t in regime r, as if the process had just been observed there:
+  // how a run forked from a checkpoint continues under its own seed
+  void start_at(TimePoint t, Regime r);
+
+  // Everything carried from one event to the next, as plain data: the
+  // raw source, the event counter, the clocks and the regime. Restoring
+  // it (into a generator built from the same config) continues the
+  // stream exactly where it was saved. restore() throws
+  // std::invalid_argument if the rng kind differs.
+  struct State {
+    Xoshiro256x4::State xoshiro;
+    uint64_t  next_event;
+    TimePoint t;
+    TimePoint due[kProcesses];     // EventScheduler::kNever: not pending
+    double    budget[kProcesses];
+    RngKind   rng;
+    Regime    regime;
+    uint8_t   pad[6];
+  };
+  State state() const;
+  void  restore(const State& s);
+
+  Regime    regime()   const { return regime_; }
+  TimePoint now()      const { return t_; }          // time of the last arrival drawn
+  uint64_t  position() const { return next_event_; } // events drawn so far
+
+private:
+  RngKind      kind_;
+  Xoshiro256x4 rng_;
+  uint64_t     key_;           // Philox key (seed)
+  uint32_t     stream_;        // Philox stream id
+  uint64_t     next_event_{0};
+  Regime       regime_{Regime::Low};
+
+  void draw_raw(std::size_t n);  // fills raw_ for events [next_event_, +n)
+
+  void      start_clocks(TimePoint t0 = 0.0, Regime r = Regime::Low); // fresh budgets
+  void      switch_regime(Regime to);          // at t_, rescaling the clocks
+  EventType arrive(uint64_t w0, uint64_t w6);  // run the clocks to the next arrival
+
+  EventScheduler clocks_{kProcesses};
+  TimePoint      t_{0.0};
+  double         budget_[kProcesses];  // unspent Exp(1) hazard of a clock not pending
+
+  // distribution constants, precomputed once
+  double rate_[2][kProcesses];  // per regime: rate of each clock, events (switches) per second
+  double log_q_limit_;        // log(1 - p) of the qty / offset geometrics
+  double log_q_market_;
+  double log_q_offset_;
+  int    max_offset_;
+
+  std::vector<uint64_t> raw_; // kWordsPerEvent words per row
+};
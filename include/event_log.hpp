@@ -0,0 +1,181 @@
+#pragma once
+#include "mapped_file.hpp"
+#include "matching_engine.hpp"
+#include "sim_config.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+Binary event log and memory-mapped replay.
+
+A log is a 32-byte header followed by fixed-size records, appended in
+order and never rewritten. The record count is not stored: it is
+(file size - header) / record size, so a log cut short by a crash is
+still readable up to its last whole record.
+
+  <path>        resolved SimEvents (24 bytes each, exactly the in-memory
+                layout), i.e. what was submitted to the engine
+  <path>.fills  optional FillRecords, in the order the engine produced them
+
+Replay maps the event file and walks the records in place: no parsing,
+no copies. Because the events are already resolved (prices and cancel
+targets fixed), replaying them into a fresh book and engine reproduces
+the original run's order ids and fills exactly.
+*/
+
+// Packed Fill for the log (Fill itself carries padding and a double ts)
+struct FillRecord {
+  int64_t  ts_ns;
+  OrderId  taker_id;
+  OrderId  maker_id;
+  Price    price;
+  uint32_t qty;
+  Side     taker_side;
+  int8_t   maker_tag;
+  uint16_t pad = 0;
+
+  static FillRecord from(const Fill& f);
+  // same trade (the tag is the producer's bookkeeping and not compared)
+  bool same_trade(const FillRecord& o) const {
+    return ts_ns == o.ts_ns && taker_id == o.taker_id && maker_id == o.maker_id &&
+           price == o.price && qty == o.qty && taker_side == o.taker_side;
+  }
+};
+static_assert(sizeof(FillRecord) == 40, "FillRecord should stay packed");
+
+struct LogHeader {
+  char     magic[8];       // "LOBEVNT1" / "LOBFILL1"
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t byte_order;     // kByteOrder as written; mismatch = foreign endianness
+  uint32_t reserved[3];
+
+  static constexpr uint32_t kVersion   = 1;
+  static constexpr uint32_t kByteOrder = 0x01020304;
+
+  static LogHeader make(const char (&magic)[8], uint32_t record_size) {
+    LogHeader h{};
+    std::memcpy(h.magic, magic, sizeof h.magic);
+    h.version     = kVersion;
+    h.record_size = record_size;
+    h.byte_order  = kByteOrder;
+    return h;
+  }
+};
+static_assert(sizeof(LogHeader) == 32, "LogHeader is 32 bytes on disk");
+
+inline constexpr char kEventMagic[8] = {'L','O','B','E','V','N','T','1'};
+inline constexpr char kFillMagic[8]  = {'L','O','B','F','I','L','L','1'};
+
+// Buffered append-only writer for the event file (and the fills file)
+class EventLogWriter {
+public:
+  explicit EventLogWriter(const std::string& path, bool with_fills = false,
+                          std::size_t buffer_bytes = 1 << 20);
+  ~EventLogWriter();   // flushes; errors there are swallowed, call close() to see them
+
+  EventLogWriter(const EventLogWriter&) = delete;
+  EventLogWriter& operator=(const EventLogWriter&) = delete;
+
+  void append(const SimEvent& e) { events_.put(&e, sizeof e); }
+  void append(const Fill& f) {
+    if (fills_.fd < 0) return;
+    const FillRecord r = FillRecord::from(f);
+    fills_.put(&r, sizeof r);
+  }
+
+  void flush();
+  void close();
+
+  uint64_t events() const { return events_.records; }
+  uint64_t fills()  const { return fills_.records; }
+  bool     with_fills() const { return fills_.fd >= 0; }
+
+private:
+  struct File {
+    int               fd = -1;
+    std::string       path;
+    std::vector<char> buf;
+    std::size_t       used = 0;
+    uint64_t          records = 0;
+
+    void open(const std::string& p, const char (&magic)[8], uint32_t record_size, std::size_t cap);
+    void put(const void* p, std::size_t n) {
+      if (used + n > buf.size()) flush();
+      std::memcpy(buf.data() + used, p, n);
+      used += n;
+      ++records;
+    }
+    void flush();
+    void close();
+  };
+  File events_, fills_;
+};
+
+// Read-only mapping of a log file's records
+template <class Record>
+class MappedLog {
+public:
+  explicit MappedLog(const std::string& path);
+
+  MappedLog(const MappedLog&) = delete;
+  MappedLog& operator=(const MappedLog&) = delete;
+
+  const Record* begin() const { return first_; }
+  const Record* end()   const { return first_ + n_; }
+  std::size_t   size()  const { return n_; }
+  const Record& operator[](std::size_t i) const { return first_[i]; }
+
+private:
+  MappedFile     file_;
+  const Record*  first_ = nullptr;
+  std::size_t    n_ = 0;
+};
+
+using EventLogReader = MappedLog<SimEvent>;
+using FillLogReader  = MappedLog<FillRecord>;
+
+struct ReplayResult {
+  uint64_t events  = 0;
+  uint64_t limits  = 0;
+  uint64_t markets = 0;
+  uint64_t cancels = 0;
+  uint64_t fills   = 0;
+  uint64_t volume  = 0;
+};
+
+// Feed resolved events straight into the engine (and the book for cancels).
+// Start from a fresh OrderBook/MatchingEngine to reproduce the original ids.
+template <class Sink>
+ReplayResult replay(const SimEvent* first, const SimEvent* last,
+                    OrderBook& ob, MatchingEngine& me, Sink&& sink) {
+  ReplayResult r;
+  auto count = [&](const Fill& f) {
+    ++r.fills;
+    r.volume += f.qty;
+    sink(f);
+  };
+  for (const SimEvent* e = first; e != last; ++e) {
+    switch (e->type) {
+      case EventType::LimitBuy:
+      case EventType::LimitSell:
+        me.submit_limit(e->side, e->px, e->qty, e->ts(), count);
+        ++r.limits;
+        break;
+      case EventType::MktBuy:
+      case EventType::MktSell:
+        me.submit_market(e->side, e->qty, e->ts(), count);
+        ++r.markets;
+        break;
+      case EventType::Cancel:
+        if (e->cancel_id) ob.cancel(e->cancel_id);
+        ++r.cancels;
+        break;
+    }
+    ++r.events;
+  }
+  return r;
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include "order_book.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/*
+NASDAQ TotalView-ITCH 5.0 ingest.
+
+Framing is the one used by ITCH capture files (and SoupBinTCP payloads):
+each message is a 2-byte big-endian length followed by that many bytes,
+the first of which is the message type. All fields are big-endian.
+
+decode() walks a buffer in place and hands each order message to a
+handler as an ItchMsg on the stack: no allocation, no copies of the
+payload. Message types we don't book (system events, directory, trades,
+imbalances...) are skipped by length. A buffer that ends mid-message is
+fine: decode() returns how many bytes it consumed, so a streaming reader
+keeps the tail and appends the next chunk to it.
+
+Book messages and what they mean for the book:
+  A / F  add order (F = with MPID attribution)       -> rest a new order
+  E / C  order executed (C = at a different price)   -> reduce, keeps priority
+  X      partial cancel                               -> reduce, keeps priority
+  D      delete                                       -> remove
+  U      replace (new ref, price and shares)          -> remove + add, loses priority
+*/
+
+struct ItchMsg {
+  char     type;          // 'A', 'F', 'E', 'C', 'X', 'D', 'U'
+  uint16_t locate;        // stock locate (instrument) code
+  uint64_t ts_ns;         // nanoseconds since midnight
+  uint64_t ref;           // order reference number (U: the original order)
+  uint64_t new_ref;       // U only
+  Side     side;          // A / F only
+  uint32_t shares;        // A/F/U: order size; E/C: executed; X: cancelled
+  uint32_t price;         // A/F/U: limit; C: execution price (1e-4 dollars)
+};
+
+namespace itch {
+
+inline uint16_t be16(const uint8_t* p) { uint16_t v; std::memcpy(&v, p, 2); return __builtin_bswap16(v); }
+inline uint32_t be32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return __builtin_bswap32(v); }
+inline uint64_t be64(const uint8_t* p) { uint64_t v; std::memcpy(&v, p, 8); return __builtin_bswap64(v); }
+inline uint64_t be48(const uint8_t* p) { return (uint64_t(be16(p)) << 32) | be32(p + 2); }
+
+// Fixed ITCH 5.0 body lengths (type byte included) of the messages we book
+constexpr std::size_t kLenAdd = 36, kLenAddMpid = 40, kLenExec = 31, kLenExecPx = 36,
+                      kLenCancel = 23, kLenDelete = 19, kLenReplace = 35;
+
+struct DecodeStats {
+  uint64_t messages = 0;   // all framed messages seen
+  uint64_t book     = 0;   // handed to the handler
+  uint64_t skipped  = 0;   // other types
+  uint64_t bad      = 0;   // book types with the wrong length
+};
+
+// Decode the framed messages in [p, p + n); h(const ItchMsg&) for book
+// messages. Returns bytes consumed (stops before a partial message).
+template <class Handler>
+std::size_t decode(const uint8_t* p, std::size_t n, Handler&& h, DecodeStats& st) {
+  std::size_t off = 0;
+  while (off + 2 <= n) {
+    const std::size_t len = be16(p + off);
+    if (off + 2 + len > n) break;                 // partial: wait for more
+    const uint8_t* m = p + off + 2;
+    off += 2 + len;
+    ++st.messages;
+    if (len == 0) { ++st.bad; continue; }
+
+    ItchMsg msg{};
+    msg.type = char(m[0]);
+    std::size_t want = 0;
+    switch (msg.type) {
+      case 'A': want = kLenAdd;     break;
+      case 'F': want = kLenAddMpid; break;
+      case 'E': want = kLenExec;    break;
+      case 'C': want = kLenExecPx;  break;
+      case 'X': want = kLenCancel;  break;
+      case 'D': want = kLenDelete;  break;
+      case 'U': want = kLenReplace; break;
+      default:  ++st.skipped; continue;
+    }
+    if (len != want) { ++st.bad; continue; }
+
+    // common header: type(1) locate(2) tracking(2) timestamp(6)
+    msg.locate = be16(m + 1);
+    msg.ts_ns  = be48(m + 5);
+    msg.ref    = be64(m + 11);
+    switch (msg.type) {
+      case 'A': case 'F':   // side(1) shares(4) stock(8) price(4) [mpid(4)]
+        msg.side   = m[19] == 'B' ? Side::Buy : Side::Sell;
+        msg.shares = be32(m + 20);
+        msg.price  = be32(m + 32);
+        break;
+      case 'E':             // shares(4) match(8)
+        msg.shares = be32(m + 19);
+        break;
+      case 'C':             // shares(4) match(8) printable(1) price(4)
+        msg.shares = be32(m + 19);
+        msg.price  = be32(m + 32);
+        break;
+      case 'X':             // cancelled shares(4)
+        msg.shares = be32(m + 19);
+        break;
+      case 'D':
+        break;
+      case 'U':             // new ref(8) shares(4) price(4)
+        msg.new_ref = be64(m + 19);
+        msg.shares  = be32(m + 27);
+        msg.price   = be32(m + 31);
+        break;
+    }
+    ++st.book;
+    h(msg);
+  }
+  return off;
+}
+
+} // namespace itch
+
+/*
+One instrument's book driven by the feed. Exchange order refs are mapped
+to our own dense OrderIds (ExternalIdMap, next to the book's own index),
+so the book keeps its one-probe dense-id lookups and never sees a ref.
+Orders go straight into the book: nothing here matches.
+*/
+class ItchBook {
+public:
+  explicit ItchBook(BookBackend b = BookBackend::Map) : book(b), ext(book.arena.resource()) {}
+
+  OrderBook     book;
+  ExternalIdMap ext;   // exchange ref -> OrderId in `book`
+
+  struct Stats {
+    uint64_t adds = 0, executes = 0, cancels = 0, deletes = 0, replaces = 0;
+    uint64_t unknown_ref = 0;   // refers to an order we never saw (e.g. joined mid-day)
+    uint64_t dup_ref     = 0;   // add for a ref already live
+  } stats;
+
+  void apply(const ItchMsg& m);
+
+private:
+  OrderId next_id_{1};
+
+  void add(uint64_t ref, Side s, uint32_t price, uint32_t shares, uint64_t ts_ns);
+  void take(uint64_t ref, uint32_t shares);   // E / C / X
+  bool remove(uint64_t ref);                  // D and the first half of U
+};
+
+// All instruments of a feed: one ItchBook per stock locate, made on first use
+class ItchFeed {
+public:
+  // only_locate = 0 books every instrument; otherwise just that one
+  explicit ItchFeed(BookBackend b = BookBackend::Map, uint16_t only_locate = 0)
+    : backend_(b), only_(only_locate) {}
+
+  void operator()(const ItchMsg& m) {
+    if (only_ && m.locate != only_) return;
+    if (m.locate >= books_.size()) books_.resize(std::size_t(m.locate) + 1);
+    auto& b = books_[m.locate];
+    if (!b) b = std::make_unique<ItchBook>(backend_);
+    b->apply(m);
+  }
+
+  // nullptr if the locate never appeared
+  const ItchBook* book(uint16_t locate) const {
+    return locate < books_.size() ? books_[locate].get() : nullptr;
+  }
+  std::size_t instruments() const;
+  std::size_t resting() const;     // orders resting across all books
+  ItchBook::Stats totals() const;
+
+private:
+  BookBackend backend_;
+  uint16_t    only_;
+  std::vector<std::unique_ptr<ItchBook>> books_;  // by locate
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Whole file mapped read-only (POSIX mmap), unmapped on destruction.
+// An empty file maps to data() == nullptr, size() == 0.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string& path, bool sequential = true);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const { return static_cast<const uint8_t*>(map_); }
+  std::size_t    size() const { return len_; }
+  const std::string& path() const { return path_; }
+
+private:
+  std::string path_;
+  void*       map_ = nullptr;
+  std::size_t len_ = 0;
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include "order_book.hpp"
+#include <algorithm>   // std::min
+#include <stdexcept>   // std::invalid_argument
 #include <vector>
 #include <optional>
 
@@ -10,30 +12,216 @@ struct Fill {
   Price price;       // execution price (maker's level)
   Qty qty;           // traded qty
   TimePoint ts;      // trade time   
+  int8_t maker_tag;  // tag the maker rested with (-1 = none)
+  int8_t taker_tag = -1; // call auctions: both orders rested, this is the taker's tag
 };
 
+/*
+Fills are handed to a sink as they happen: any callable taking
+(const Fill&). The sink is a template parameter, so the call is inlined
+into the matching loop and nothing is buffered or allocated per order.
+The sink runs while the maker is still at the front of its level and
+must not add or cancel orders (touching Order::tag is fine).
+
+The std::vector<Fill>& overloads are kept for callers that want a list.
+*/
 struct MatchingEngine {
   explicit MatchingEngine(OrderBook& ob) : book(ob) {}
 
   // Public API
+  template <class Sink>
+  OrderId submit_market(Side s, Qty q, TimePoint t, Sink&& sink);
+  template <class Sink>
+  OrderId submit_limit (Side s, Price px, Qty q, TimePoint t, Sink&& sink,
+                        int8_t tag = -1); // tag stays on the resting remainder
+
+  // Limit with a time in force. IOC and FOK never rest. FOK is decided
+  // up front from the level aggregates (fillable), so a kill leaves the book
+  // untouched and produces no fills. Returns the order's id either way.
+  template <class Sink>
+  OrderId submit_limit (Side s, Price px, Qty q, TimeInForce tif, TimePoint t, Sink&& sink,
+                        int8_t tag = -1);
+
+  // Market order that will not trade through `protect` (buy: no higher,
+  // sell: no lower); what is left at the protection price is dropped, as
+  // with an IOC limit at that price
+  template <class Sink>
+  OrderId submit_market_protected(Side s, Qty q, Price protect, TimePoint t, Sink&& sink);
+
+  // Cancel a resting order; false if it is not in the book (filled,
+  // cancelled or never there)
+  bool submit_cancel(OrderId id) { return book.cancel(id); }
+
+  // Modify a resting order to (px, q), keeping its id and tag:
+  //   same price, smaller qty: trimmed in place, keeps time priority
+  //   same price, larger qty:  back of its level
+  //   new price, not crossing: one move to the back of the new level
+  //   new price, crossing:     trades as a taker first (fills to sink),
+  //                            the remainder rests at px
+  // Returns false (and does nothing) if id is not resting.
+  template <class Sink>
+  bool submit_replace(OrderId id, Price px, Qty q, TimePoint t, Sink&& sink);
+
+  // Could a taker on side s limited at px fill q right now? Walks the
+  // opposite side's aggregates best-first and stops as soon as q is covered.
+  bool fillable(Side s, Price px, Qty q) const {
+    return s == Side::Buy ? fillable<Side::Buy>(px, q) : fillable<Side::Sell>(px, q);
+  }
+
+  // Id the next order gets. Checkpoints save it and restore it with
+  // resume_ids, which must not go back below an id already handed out.
+  OrderId next_order_id() const { return next_id; }
+  void    resume_ids(OrderId next) { next_id = next; }
+  // Hand out the next id to an order that is placed without matching
+  // (call auctions, see auction.hpp), so ids stay unique across both
+  OrderId assign_id() { return next_id++; }
+
   OrderId submit_market(Side s, Qty q, TimePoint t, std::vector<Fill>& out);
-  OrderId submit_limit (Side s, Price px, Qty q, TimePoint t, std::vector<Fill>& out);
+  OrderId submit_limit (Side s, Price px, Qty q, TimePoint t, std::vector<Fill>& out,
+                        int8_t tag = -1);
+  OrderId submit_limit (Side s, Price px, Qty q, TimeInForce tif, TimePoint t,
+                        std::vector<Fill>& out, int8_t tag = -1);
+  OrderId submit_market_protected(Side s, Qty q, Price protect, TimePoint t, std::vector<Fill>& out);
+  bool    submit_replace(OrderId id, Price px, Qty q, TimePoint t, std::vector<Fill>& out);
 
 private:
-  // MUST match src/matching_engine.cpp exactly:
-  void match_buy (OrderId taker_id, Qty& remaining, TimePoint t,
-                  std::vector<Fill>& out, std::optional<Price> limit_px);
-  void match_sell(OrderId taker_id, Qty& remaining, TimePoint t,
-                  std::vector<Fill>& out, std::optional<Price> limit_px);
-
-  // Inline helper to reindex positions after pop_front
-  static void reindex_after_pop_front(LevelQueue& q, OrderBook& book, Side /*side*/, Price /*px*/) {
-    for (std::size_t p = 0; p < q.size(); ++p) {
-      auto it = book.index.find(q[p].id);
-      if (it != book.index.end()) it->second.pos = p;
-    }
+  // One matcher for both sides: a taker on side S walks the opposite book
+  // side best-first while its limit still crosses. Markets pass
+  // SideTraits<S>::kNoLimit, so the gate needs no optional/branch on type.
+  template <Side S, class Sink>
+  void match(OrderId taker_id, Qty& remaining, TimePoint t, Sink& sink, Price limit_px);
+
+  // Runtime Side -> compile-time S
+  template <class Sink>
+  void match(Side s, OrderId taker_id, Qty& remaining, TimePoint t, Sink& sink,
+             std::optional<Price> limit_px) {
+    if (s == Side::Buy)
+      match<Side::Buy>(taker_id, remaining, t, sink, limit_px.value_or(SideTraits<Side::Buy>::kNoLimit));
+    else
+      match<Side::Sell>(taker_id, remaining, t, sink, limit_px.value_or(SideTraits<Side::Sell>::kNoLimit));
   }
 
+  template <Side S> bool fillable(Price limit_px, Qty q) const;
+
   OrderId next_id{1};
   OrderBook& book;
-};
\ No newline at end of file
+};
+
+// ---- template definitions ----
+
+template <class Sink>
+OrderId MatchingEngine::submit_market(Side s, Qty q, TimePoint t, Sink&& sink) {
+  if (q <= 0) throw std::invalid_argument("market qty must be > 0");
+  OrderId id = next_id++;
+  match(s, id, q, t, sink, std::nullopt);
+  return id; // market remainder is discarded
+}
+
+template <class Sink>
+OrderId MatchingEngine::submit_limit(Side s, Price px, Qty q, TimePoint t, Sink&& sink,
+                                     int8_t tag) {
+  return submit_limit(s, px, q, TimeInForce::GTC, t, sink, tag);
+}
+
+template <class Sink>
+OrderId MatchingEngine::submit_limit(Side s, Price px, Qty q, TimeInForce tif, TimePoint t,
+                                     Sink&& sink, int8_t tag) {
+  if (q <= 0) throw std::invalid_argument("limit qty must be > 0");
+  if (px <= 0) throw std::invalid_argument("limit price must be > 0");
+  OrderId id = next_id++;
+  if (tif == TimeInForce::FOK && !fillable(s, px, q)) return id; // killed, book untouched
+  match(s, id, q, t, sink, px);
+  if (q > 0 && tif == TimeInForce::GTC) {
+    Order o{ id, s, OrdType::Limit, px, q, t, tag };
+    book.add_limit(o);
+  }
+  return id;
+}
+
+template <class Sink>
+OrderId MatchingEngine::submit_market_protected(Side s, Qty q, Price protect, TimePoint t,
+                                                Sink&& sink) {
+  if (q <= 0) throw std::invalid_argument("market qty must be > 0");
+  if (protect <= 0) throw std::invalid_argument("protection price must be > 0");
+  OrderId id = next_id++;
+  match(s, id, q, t, sink, protect);
+  return id; // remainder beyond the protection price is discarded
+}
+
+template <class Sink>
+bool MatchingEngine::submit_replace(OrderId id, Price px, Qty q, TimePoint t, Sink&& sink) {
+  if (q <= 0) throw std::invalid_argument("replace qty must be > 0");
+  if (px <= 0) throw std::invalid_argument("replace price must be > 0");
+  const RestingOrder* o = book.find(id);
+  if (!o) return false;
+
+  if (px == o->limit_price) {
+    if (q < o->qty) book.reduce(id, o->qty - q);   // size-down keeps priority
+    else if (q > o->qty) book.move(id, px, q, t);  // size-up goes to the back
+    return true;
+  }
+
+  const Side s = o->side;
+  const bool crosses = (s == Side::Buy)
+      ? (!book.asks.empty() && SideTraits<Side::Buy>::crosses(px, book.best_ask()))
+      : (!book.bids.empty() && SideTraits<Side::Sell>::crosses(px, book.best_bid()));
+  if (!crosses) {
+    book.move(id, px, q, t);
+    return true;
+  }
+
+  // marketable at the new price: out of the book, match under its own id,
+  // rest whatever is left
+  const int8_t tag = o->tag;
+  book.cancel(id);
+  match(s, id, q, t, sink, px);
+  if (q > 0) book.add_limit(Order{ id, s, OrdType::Limit, px, q, t, tag });
+  return true;
+}
+
+/*
+Feasibility from the aggregates alone: one step per crossing level, and
+no order is looked at. Nothing is mutated, so a FOK that cannot complete
+costs a short read of the top of the book instead of a partial match
+that would have to be rolled back.
+*/
+template <Side S>
+bool MatchingEngine::fillable(Price limit_px, Qty q) const {
+  using Taker = SideTraits<S>;
+  Qty avail = 0;
+  book.side<Taker::kOpposite>().for_each_level([&](Price px, const LevelQueue& lvl) {
+    if (!Taker::crosses(limit_px, px)) return false;
+    avail += lvl.total_qty;
+    return avail < q;
+  });
+  return avail >= q;
+}
+
+template <Side S, class Sink>
+void MatchingEngine::match(OrderId taker_id, Qty& remaining, TimePoint t,
+                           Sink& sink, Price limit_px) {
+  using Taker = SideTraits<S>;
+  auto& resting = book.side<Taker::kOpposite>();
+
+  while (remaining > 0 && !resting.empty()) {
+    const Price px = resting.best_price();      // best opposite price
+    if (!Taker::crosses(limit_px, px)) break;   // limit gate
+
+    LevelQueue& q = resting.best_level();       // FIFO at px
+    book.mark_dirty(Taker::kOpposite, px);      // once per level we trade at
+    while (remaining > 0 && !q.empty()) {
+      RestingOrder& maker = book.front(q);
+      Qty traded = std::min(remaining, maker.qty);
+
+      sink(Fill{ taker_id, maker.id, S, px, traded, t, maker.tag });
+
+      book.fill_front(q, traded);               // maker and level totals
+      remaining -= traded;
+
+      if (maker.qty == 0) {
+        book.pop_front(q);
+      }
+    }
+    if (q.empty()) resting.erase_best();
+  }
+}
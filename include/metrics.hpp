@@ -0,0 +1,399 @@
+#pragma once
+#include "matching_engine.hpp"
+#include "sim_config.hpp"
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Hot-path latency instrumentation (LatencyHistogram, LatencyProfile and
+// the LOB_LAT hook below). Off unless built with -DLOB_LATENCY=1; when off,
+// every LOB_LAT(...) statement disappears and Simulator carries no profile.
+#ifndef LOB_LATENCY
+#define LOB_LATENCY 0
+#endif
+#if LOB_LATENCY
+#define LOB_LAT(...) __VA_ARGS__
+#else
+#define LOB_LAT(...)
+#endif
+
+/*
+Per-run telemetry, as a plain value. A Simulator fills one of these at
+the end of a run; sweeps collect one per run and reduce them afterwards,
+so nothing here is shared between runs while they execute.
+*/
+struct SimStats {
+  uint64_t seed = 0;
+
+  size_t events  = 0;
+  size_t limits  = 0;
+  size_t markets = 0;
+  size_t cancels = 0;
+  size_t trades  = 0;
+  uint64_t vol   = 0;
+
+  double avg_spread   = 0.0;  // per event, ticks
+  double avg_mid      = 0.0;
+  int    max_drawdown = 0;    // ticks, peak-to-trough of mid
+  double slip_buy_vw  = 0.0;  // qty-weighted market order slippage vs. mid
+  double slip_sell_vw = 0.0;
+
+  // spread over two-sided events (streaming, see SpreadMidStats)
+  double spread_sd  = 0.0;
+  double spread_p50 = 0.0;
+  double spread_p99 = 0.0;
+  double tw_spread  = 0.0;    // time-weighted over sim time (0 if no time elapsed)
+
+  // arrivals in simulated time (see ArrivalRate)
+  double   sim_seconds        = 0.0;  // from the run's start to its last event
+  double   events_per_sim_sec = 0.0;
+  uint64_t windows            = 0;    // metrics windows closed
+  double   window_eps_min = 0.0, window_eps_max = 0.0, window_eps_sd = 0.0;
+
+  // limit orders per offset bucket (0, 1-2, 3-5, 6-10, >10) and how many got filled
+  std::array<uint64_t, 5> lim_total{};
+  std::array<uint64_t, 5> lim_filled{};
+
+  double fill_ratio(int bucket) const {
+    return lim_total[bucket] ? double(lim_filled[bucket]) / double(lim_total[bucket]) : 0.0;
+  }
+};
+
+// Sample mean, standard deviation and 95% confidence half-width of the mean
+struct MetricSummary {
+  size_t n    = 0;
+  double mean = 0.0;
+  double sd   = 0.0;
+  double ci95 = 0.0;   // mean +/- ci95 (Student t for small n)
+};
+
+MetricSummary summarize(const std::vector<double>& xs);
+
+// The headline metrics of a set of runs (typically: one config, many seeds)
+struct StatsSummary {
+  size_t runs = 0;
+  MetricSummary avg_spread;
+  MetricSummary slip_buy_vw;
+  MetricSummary slip_sell_vw;
+  MetricSummary max_drawdown;
+  MetricSummary trades;
+  std::array<MetricSummary, 5> fill_ratio;
+};
+
+StatsSummary summarize(const SimStats* runs, size_t n);
+
+/*
+Timestamps for latency: the TSC where there is one (a single instruction,
+no syscall, no vDSO), steady_clock elsewhere. Tick-to-ns is calibrated
+per run against steady_clock (TscCalibration), so histograms store raw
+ticks and only the report converts.
+*/
+inline uint64_t lat_now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct TscCalibration {
+  uint64_t tsc0 = lat_now();
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  // ns per tick, measured over the calibration's lifetime so far
+  double ns_per_tick() const {
+    const uint64_t ticks = lat_now() - tsc0;
+    const double   ns    = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    return ticks ? ns / double(ticks) : 1.0;
+  }
+};
+
+/*
+Log-linear histogram in the style of HdrHistogram: values below 2^kSubBits
+get a bucket each; above that, every power-of-two range is split into
+2^(kSubBits-1) equal buckets, so a bucket is never wider than 1/16 of its
+value (about 6% worst-case error on any quantile) across the whole
+64-bit range. record() is a bit scan, a shift and one increment.
+*/
+class LatencyHistogram {
+public:
+  static constexpr unsigned kSubBits = 5;
+  static constexpr unsigned kHalf    = 1u << (kSubBits - 1);
+  static constexpr std::size_t kBuckets = (64 - kSubBits + 2) * kHalf;
+
+  void record(uint64_t v, uint64_t count = 1) {
+    counts_[index(v)] += count;
+    total_ += count;
+    if (v > max_) max_ = v;
+  }
+  void merge(const LatencyHistogram& o);
+
+  uint64_t count() const { return total_; }
+  uint64_t max()   const { return max_; }
+  // Smallest recorded bucket whose cumulative count reaches q (0..1); the
+  // bucket's upper edge, capped at max()
+  uint64_t quantile(double q) const;
+
+  static std::size_t index(uint64_t v) {
+    const unsigned msb   = unsigned(std::bit_width(v | 1)) - 1;
+    const unsigned shift = msb < kSubBits ? 0 : msb - (kSubBits - 1);
+    return std::size_t(shift) * kHalf + std::size_t(v >> shift);
+  }
+  static uint64_t lower_bound(std::size_t i) {
+    const unsigned shift = i < 2 * kHalf ? 0 : unsigned(i / kHalf) - 1;
+    return uint64_t(i - std::size_t(shift) * kHalf) << shift;
+  }
+
+private:
+  std::array<uint64_t, kBuckets> counts_{};
+  uint64_t total_ = 0;
+  uint64_t max_   = 0;
+};
+
+// Where an event's time goes. Matching and the resting-book update happen
+// inside one engine call, so they are one stage (Match).
+enum class Stage : uint8_t { Generate, Resolve, Match, Telemetry };
+inline constexpr std::size_t kStages = 4;
+
+/*
+One run's latency profile: a histogram per stage, plus whole-event
+latency (resolve + match + telemetry) per EventType. Events are timed one
+in `sample_every` (each timed event costs four clock reads, tens of ns on
+some VMs); generation is timed per batch and recorded as the per-event
+average, weighted by the batch size.
+*/
+struct LatencyProfile {
+  static constexpr std::size_t kTypes = 5;   // EventType values
+
+  explicit LatencyProfile(uint32_t sample_every = 64) : every(sample_every ? sample_every : 1) {}
+
+  std::array<LatencyHistogram, kStages> stage;
+  std::array<LatencyHistogram, kTypes>  by_type;
+  uint32_t       every;
+  TscCalibration clock;
+
+  bool sampled(std::size_t event) const { return event % every == 0; }
+
+  // p50 / p99 / p99.9 / max of each non-empty histogram, in ns
+  void print(std::ostream& os, const char* const type_names[kTypes]) const;
+};
+
+// ---- streaming estimators: O(1) memory and update, whatever the run length ----
+
+// Running mean / variance (Welford), numerically stable over long runs
+struct Welford {
+  uint64_t n    = 0;
+  double   mean = 0.0;
+  double   m2   = 0.0;
+
+  void add(double x) {
+    ++n;
+    const double d = x - mean;
+    mean += d / double(n);
+    m2 += d * (x - mean);
+  }
+  double var() const { return n > 1 ? m2 / double(n - 1) : 0.0; }
+  double sd()  const;
+};
+
+// Time-weighted mean of a piecewise-constant signal: update(t, v) says the
+// signal is v from time t on. Mean over [first update, last update].
+class TimeWeighted {
+public:
+  void update(double t, double v) {
+    if (n_++) area_ += last_ * (t - t_last_);
+    else      t0_ = t;
+    last_ = v;
+    t_last_ = t;
+  }
+  double mean() const {
+    const double span = t_last_ - t0_;
+    return span > 0.0 ? area_ / span : 0.0;
+  }
+
+private:
+  uint64_t n_ = 0;
+  double   t0_ = 0.0, t_last_ = 0.0, last_ = 0.0, area_ = 0.0;
+};
+
+/*
+Simulator observers. A Simulator is built over one observer type (see
+BasicSimulator in sim.hpp) and calls its hooks as plain member calls, so
+they inline into the event loop. If Obs::kEnabled is false the hooks are
+never called, and the work that only feeds them (fill sums, mid before a
+market order, offset buckets) is compiled out as well.
+
+An observer provides:
+  void   configure(const SimConfig&)                 once, at construction
+  void   on_start(TimePoint t0)                      once, as the run starts at
+         sim time t0 (0, or the time of the checkpoint it was restored from)
+  int8_t on_limit(Side, Price px, const OrderBook&)  before a limit is submitted;
+         returns the tag it should rest with (-1 = none)
+  void   on_fill(const Fill&)                        every fill (maker_tag is
+         the resting tag, and in a call auction taker_tag too; the Simulator
+         clears them after the first fill, so each tagged order is reported
+         filled once)
+  void   on_market(Side, Price mid_before, uint64_t qty, double notional)
+         after a market order, with what it traded
+  void   on_event(const SimEvent&, const OrderBook&) after every event, resolved
+  void   on_window(TimePoint end)                    the Simulator's metrics window
+         timer rang: a window of SimConfig::metrics_window sim seconds ended
+         at `end` (before any event at or after it)
+  void   report(SimStats&) const                     its share of the results
+
+Observers<A, B, ...> chains several; each part keeps fixed-size state, so
+memory does not grow with the number of events or orders.
+*/
+
+// Event counts by kind, trades and volume
+struct FlowCounters {
+  uint64_t limits = 0, markets = 0, cancels = 0, trades = 0, vol = 0;
+
+  void configure(const SimConfig&) {}
+  void on_start(TimePoint) {}
+  int8_t on_limit(Side, Price, const OrderBook&) { return -1; }
+  void on_fill(const Fill& f) { ++trades; vol += uint64_t(f.qty); }
+  void on_market(Side, Price, uint64_t, double) {}
+  void on_event(const SimEvent& e, const OrderBook&) {
+    switch (e.type) {
+      case EventType::LimitBuy:
+      case EventType::LimitSell: ++limits;  break;
+      case EventType::MktBuy:
+      case EventType::MktSell:   ++markets; break;
+      case EventType::Cancel:    ++cancels; break;
+    }
+  }
+  void on_window(TimePoint) {}
+  void report(SimStats& st) const;
+};
+
+// Fill ratio of limit orders by distance from mid at entry: the bucket
+// rides on the resting order as its tag
+struct FillByDistance {
+  std::array<uint64_t, 5>  total{};
+  std::array<uint64_t, 5>  filled{};
+  uint64_t                 offset_count = 0, offset_abs_sum = 0;
+  std::array<uint64_t, 64> offset_hist{};   // |offset| in ticks, 0..63 (larger are not binned)
+  int                      max_offset = 0;  // clamp for |offset| (0 = none)
+
+  static int bucket_of(int k) {
+    if (k <= 0) return 0;   // at mid
+    if (k <= 2) return 1;   // 1-2 ticks
+    if (k <= 5) return 2;   // 3-5
+    if (k <= 10) return 3;  // 6-10
+    return 4;               // >10
+  }
+
+  void configure(const SimConfig& c) { max_offset = c.max_offset_ticks; }
+  void on_start(TimePoint) {}
+  int8_t on_limit(Side s, Price px, const OrderBook& ob);
+  void on_fill(const Fill& f) {
+    if (f.maker_tag >= 0) ++filled[f.maker_tag];
+    if (f.taker_tag >= 0) ++filled[f.taker_tag];
+  }
+  void on_market(Side, Price, uint64_t, double) {}
+  void on_event(const SimEvent&, const OrderBook&) {}
+  void on_window(TimePoint) {}
+  void report(SimStats& st) const;
+};
+
+// Spread and mid over two-sided books: per-event sums (as SimStats has
+// always reported), streaming sd / p50 / p99 of the spread, its
+// time-weighted mean, and the mid's peak-to-trough drawdown. Spreads are
+// whole ticks, so the log-linear histogram serves as the quantile sketch:
+// exact below 32 ticks, within 1/16 above, 8 KB whatever the run length.
+struct SpreadMidStats {
+  uint64_t         events = 0;     // all events (the avg_spread denominator)
+  double           sum_spread = 0.0;
+  uint64_t         mid_samples = 0;
+  double           sum_mid = 0.0;
+  Price            peak_mid = 0;
+  Price            max_drawdown = 0;
+  Welford          spread;
+  LatencyHistogram spread_hist;
+  TimeWeighted     tw_spread;
+
+  void configure(const SimConfig&) {}
+  void on_start(TimePoint) {}
+  int8_t on_limit(Side, Price, const OrderBook&) { return -1; }
+  void on_fill(const Fill&) {}
+  void on_market(Side, Price, uint64_t, double) {}
+  void on_event(const SimEvent& e, const OrderBook& ob);
+  void on_window(TimePoint) {}
+  void report(SimStats& st) const;
+};
+
+// Market order slippage vs. the mid before the order, qty-weighted
+struct Slippage {
+  double   buy = 0.0, sell = 0.0;
+  uint64_t buy_qty = 0, sell_qty = 0;
+
+  void configure(const SimConfig&) {}
+  void on_start(TimePoint) {}
+  int8_t on_limit(Side, Price, const OrderBook&) { return -1; }
+  void on_fill(const Fill&) {}
+  void on_market(Side s, Price mid_before, uint64_t qty, double notional) {
+    if (!qty) return;
+    const double vwap = notional / double(qty);
+    if (s == Side::Buy) { buy  += (vwap - double(mid_before)) * double(qty); buy_qty  += qty; }
+    else                { sell += (double(mid_before) - vwap) * double(qty); sell_qty += qty; }
+  }
+  void on_event(const SimEvent&, const OrderBook&) {}
+  void on_window(TimePoint) {}
+  void report(SimStats& st) const;
+};
+
+// Arrival rate in simulated time: events per sim second over the whole
+// run, and spread / extremes over the metrics windows
+struct ArrivalRate {
+  uint64_t  events = 0;
+  uint64_t  in_window = 0;     // events since the last window closed
+  TimePoint t0 = 0.0;          // run start
+  TimePoint last_t = 0.0;      // time of the latest event
+  TimePoint width = 0.0;       // window length, sim seconds (0 = no windows)
+  Welford   window_rate;       // events / sec of each closed window
+  double    min_rate = 0.0, max_rate = 0.0;
+
+  void configure(const SimConfig& c) { width = c.metrics_window; }
+  void on_start(TimePoint t) { t0 = t; last_t = t; }
+  int8_t on_limit(Side, Price, const OrderBook&) { return -1; }
+  void on_fill(const Fill&) {}
+  void on_market(Side, Price, uint64_t, double) {}
+  void on_event(const SimEvent& e, const OrderBook&) { ++events; ++in_window; last_t = e.ts(); }
+  void on_window(TimePoint end);
+  void report(SimStats& st) const;
+};
+
+template <class... Parts>
+struct Observers : Parts... {
+  static constexpr bool kEnabled = sizeof...(Parts) > 0;
+
+  void configure(const SimConfig& c) { (Parts::configure(c), ...); }
+  void on_start(TimePoint t0) { (Parts::on_start(t0), ...); }
+  int8_t on_limit(Side s, Price px, const OrderBook& ob) {
+    int8_t tag = -1;
+    ((tag = std::max(tag, Parts::on_limit(s, px, ob))), ...);
+    return tag;
+  }
+  void on_fill(const Fill& f) { (Parts::on_fill(f), ...); }
+  void on_market(Side s, Price mid, uint64_t qty, double notional) {
+    (Parts::on_market(s, mid, qty, notional), ...);
+  }
+  void on_event(const SimEvent& e, const OrderBook& ob) { (Parts::on_event(e, ob), ...); }
+  void on_window(TimePoint end) { (Parts::on_window(end), ...); }
+  void report(SimStats& st) const { (Parts::report(st), ...); }
+
+  template <class P> P&       part()       { return *this; }
+  template <class P> const P& part() const { return *this; }
+};
+
+// What SimStats reports; and nothing at all, for raw throughput runs
+using SimTelemetry = Observers<FlowCounters, FillByDistance, SpreadMidStats, Slippage, ArrivalRate>;
+using NoTelemetry  = Observers<>;
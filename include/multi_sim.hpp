@@ -0,0 +1,63 @@
+#pragma once
+#include "metrics.hpp"
+#include "sim_config.hpp"
+#include <cstddef>
+#include <vector>
+
+/*
+Multi-instrument driver: one Simulator (book + engine + telemetry) per
+symbol, sharded across threads.
+
+  router (calling thread)          shard threads
+  -----------------------          -------------
+  per-symbol EventGenerators  -->  SPSC ring per shard  -->  apply() on
+  + common market regime           (symbol, SimEvent)        the symbol's book
+
+Symbol s lives on shard s % shards, and only that shard's thread ever
+touches its book (shared-nothing). The router only does book-independent
+draws (see event_gen.hpp), so every symbol sees exactly the events a
+single-threaded run would, in the same order: results don't depend on
+the shard count.
+
+Correlated regimes: the router also runs one market-wide regime, a
+process in sim time with the same switch rates as a symbol's own
+(base.regime, see RegimePath in event_gen.hpp). Before each of its
+events, a symbol takes the market regime as of its own clock with
+probability regime_follow, besides its own switches; symbols that are
+at the same sim time therefore see the same market, however many
+events each has had.
+*/
+struct MultiSimConfig {
+  SimConfig base;                 // per-symbol model; max_events is per symbol
+  uint32_t  n_symbols{1};
+  unsigned  shards{0};            // matching threads; 0 = hardware concurrency
+  double    regime_follow{0.0};   // 0 = independent regimes, 1 = all follow the market
+  size_t    ring_capacity{1 << 14};
+};
+
+struct MultiSimResult {
+  std::vector<SimStats> symbols;  // indexed by SymbolId
+  size_t events = 0;              // all symbols
+  double wall_s = 0.0;
+  double events_per_sec() const { return wall_s > 0.0 ? double(events) / wall_s : 0.0; }
+};
+
+class MultiSimulator {
+public:
+  explicit MultiSimulator(const MultiSimConfig& cfg);
+
+  // Rethrows the first exception of a shard (lowest shard) after all
+  // have joined
+  MultiSimResult run();
+
+  unsigned shards() const { return shards_; }
+  unsigned shard_of(SymbolId s) const { return s % shards_; }
+
+  // Per-symbol config: Philox runs share the seed and use the symbol as
+  // their stream; Xoshiro runs get a seed derived from (seed, symbol)
+  static SimConfig symbol_config(const SimConfig& base, SymbolId s);
+
+private:
+  MultiSimConfig cfg_;
+  unsigned       shards_;
+};
@@ -8,5 +8,6 @@ struct Order {
     Price limit_price; // ignored for market orders
     Qty qty;
     TimePoint ts;
+    int8_t tag = -1;   // caller's label, echoed back in fills (-1 = none)
 };
 
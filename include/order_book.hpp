@@ -1,27 +1,193 @@
 #pragma once
 #include "order.hpp"
+#include "arena.hpp"
+#include "order_index.hpp"
+#include "price_ladder.hpp"
+#include "side_traits.hpp"
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
 
-// A flexible list that holds Orders, where I can add/remove from both ends
-using LevelQueue = std::deque<Order>;
+/*
+A resting order as the book keeps it: one node of the pool, the order's
+fields and its links to the neighbours at the same price. Only what a
+resting order still needs is kept (no type: it is always a limit), and
+side and tag sit in what would be padding, so a node is 48 bytes where
+an Order plus links was 64.
+*/
+struct RestingOrder {
+  OrderId     id;
+  Price       limit_price;
+  Qty         qty;
+  TimePoint   ts;
+  OrderHandle prev{kNullHandle};   // the book's links: not to be touched
+  OrderHandle next{kNullHandle};
+  uint32_t    live_slot{0};        // position in OrderBook's resting list
+  Side        side;
+  int8_t      tag;                 // Order::tag
+};
+static_assert(sizeof(RestingOrder) == 48, "a resting order is 48 bytes");
+
+// A price level: FIFO of orders, chained through the node pool
+// (doubly-linked, so removing from anywhere in the line is O(1)).
+// count and total_qty are kept up to date by every add, cancel, reduce
+// and fill, so level depth never needs a walk of the orders.
+struct LevelQueue {
+  OrderHandle head{kNullHandle};
+  OrderHandle tail{kNullHandle};
+  std::size_t count{0};
+  Qty         total_qty{0};   // sum of the resting orders' qty
+
+  bool empty() const { return count == 0; }
+  std::size_t size() const { return count; }
+};
+
+// One aggregated level, as returned by OrderBook::depth
+struct DepthLevel {
+  Price    px;
+  Qty      qty;
+  uint32_t count;
+  bool operator==(const DepthLevel&) const = default;
+};
+
+// What a market order would do against the book as it stands (see
+// OrderBook::estimate_impact)
+struct ImpactEstimate {
+  Qty      filled = 0;   // qty the book could fill (less than asked if it runs dry)
+  int64_t  cost   = 0;   // sum of price * qty over the fills, tick-units (exact)
+  Price    worst  = 0;   // price of the last level touched (0: nothing to fill)
+  uint32_t levels = 0;   // levels touched, the last one possibly in part
+
+  double vwap() const { return filled ? double(cost) / double(filled) : 0.0; }
+};
+
+// Which container holds the price levels of each side
+enum class BookBackend : uint8_t {
+  Map,    // std::map keyed by price (sparse, any price range)
+  Ladder  // flat tick-indexed array + bitmap (prices clustered near mid)
+};
+
+/*
+One side of the book: price -> LevelQueue, ordered best-first
+(highest bid / lowest ask, see SideTraits). The backend is picked once at
+construction so both containers can be A/B'd under the same seed.
+*/
+template <Side S>
+class BookSide {
+public:
+  BookSide(BookBackend b, std::pmr::memory_resource* mr)
+    : flat_(b == BookBackend::Ladder), map_(mr), ladder_(mr) {}
+
+  bool empty() const { return flat_ ? ladder_.empty() : map_.empty(); }
+  std::size_t size() const { return flat_ ? ladder_.size() : map_.size(); } // # levels
+  std::size_t count(Price px) const { return find(px) ? 1 : 0; }
+
+  // Best price / level (side must not be empty)
+  Price best_price() const {
+    if (flat_) return kBestIsHigh ? ladder_.highest() : ladder_.lowest();
+    return map_.begin()->first;
+  }
+  LevelQueue& best_level() {
+    if (flat_) return kBestIsHigh ? ladder_.at_highest() : ladder_.at_lowest();
+    return map_.begin()->second;
+  }
+  // Worst price: the far end, lowest bid / highest ask (side must not be empty)
+  Price worst_price() const {
+    if (flat_) return kBestIsHigh ? ladder_.lowest() : ladder_.highest();
+    return map_.rbegin()->first;
+  }
+  void erase_best() {
+    if (flat_) ladder_.erase(best_price());
+    else       map_.erase(map_.begin());
+  }
+
+  LevelQueue* find(Price px) {
+    if (flat_) return ladder_.find(px);
+    auto it = map_.find(px);
+    return it == map_.end() ? nullptr : &it->second;
+  }
+  const LevelQueue* find(Price px) const {
+    if (flat_) return ladder_.find(px);
+    auto it = map_.find(px);
+    return it == map_.end() ? nullptr : &it->second;
+  }
+
+  LevelQueue& operator[](Price px) { return flat_ ? ladder_.get(px) : map_[px]; } // creates level if missing
+  void erase(Price px) { if (flat_) ladder_.erase(px); else map_.erase(px); }
+
+  // Visit levels best-first: f(Price, const LevelQueue&), may return false to stop
+  template <class F>
+  void for_each_level(F&& f) const {
+    if (flat_) { ladder_.template walk<!kBestIsHigh>(f); return; }
+    for (const auto& [px, q] : map_) {
+      if constexpr (std::is_same_v<decltype(f(px, q)), bool>) { if (!f(px, q)) return; }
+      else f(px, q);
+    }
+  }
+
+  // Best-first take of `want` off the level aggregates, for impact
+  // queries: adds to cost (price * qty) and levels, sets worst to the last
+  // price touched, returns the qty taken. Ladder: a bitmap word at a time
+  // (PriceLadder::take); map: level by level.
+  Qty take(Qty want, int64_t& cost, Price& worst, uint32_t& levels) const {
+    if (flat_)
+      return ladder_.template take<!kBestIsHigh>(
+          want, [](const LevelQueue& q) { return q.total_qty; }, cost, worst, levels);
+    Qty left = want;
+    for (auto it = map_.begin(); it != map_.end() && left > 0; ++it) {
+      const Qty q = std::min(left, it->second.total_qty);
+      left  -= q;
+      cost  += it->first * q;
+      worst  = it->first;
+      ++levels;
+    }
+    return want - left;
+  }
+
+  bool consistent() const { return !flat_ || ladder_.consistent(); }
+
+private:
+  using Traits = SideTraits<S>;
+  using Cmp    = typename Traits::Cmp;
+  static constexpr bool kBestIsHigh = Traits::kBestIsHigh;
+
+  bool flat_;
+  std::pmr::map<Price, LevelQueue, Cmp> map_;
+  PriceLadder<LevelQueue>                ladder_;
+};
+
+using BidSide = BookSide<Side::Buy>;
+using AskSide = BookSide<Side::Sell>;
 
 struct OrderBook {
-  std::map<Price, LevelQueue, std::greater<Price>> bids;
-  std::map<Price, LevelQueue, std::less<Price>> asks;
+  explicit OrderBook(BookBackend b = BookBackend::Map)
+    : bids(b, arena.resource()), asks(b, arena.resource()),
+      index(arena.resource()), nodes_(arena.resource()), free_(arena.resource()),
+      live_(arena.resource()),
+      dirty_{ std::pmr::vector<Price>(arena.resource()), std::pmr::vector<Price>(arena.resource()) } {}
+
+  Arena   arena; // first: every container below allocates from it
+
+  BidSide bids;
+  AskSide asks;
 
-  struct IndexEntry { 
-    Side side; // buy or sell
-    Price px;  // price of order
-    size_t pos; // position in list
-  };
-  std::unordered_map<OrderId, IndexEntry> index; // hash table
+  // Compile-time side access: side<Side::Buy>() is bids, side<Side::Sell>() is asks
+  template <Side S> BookSide<S>& side() {
+    if constexpr (S == Side::Buy) return bids; else return asks;
+  }
+  template <Side S> const BookSide<S>& side() const {
+    if constexpr (S == Side::Buy) return bids; else return asks;
+  }
+
+  OrderIndex index; // id -> node in the pool (flat hash table)
 
   // ternary operator (one-line if)
     // condition ? value_if_true : value_if_false
-  Price best_bid() const { 
-    return bids.empty() ? 0 : bids.begin()->first; 
+  Price best_bid() const {
+    return bids.empty() ? 0 : bids.best_price();
   }
-  Price best_ask() const { 
-    return asks.empty () ? 0 : asks.begin()->first; 
+  Price best_ask() const {
+    return asks.empty () ? 0 : asks.best_price();
   }
   Price mid() const {
     if (bids.empty() || asks.empty()) return 0;
@@ -31,7 +197,132 @@ struct OrderBook {
   // &: don't copy whole thing, just refer to it
   // o: name of parameter inside function
   void add_limit(const Order& o);
-  void cancel(OrderId id);
+  // Room for n resting orders (node pool, resting list, index), e.g.
+  // before restoring a checkpoint
+  void reserve(std::size_t n);
+  bool cancel(OrderId id);   // false if the id is not resting
+
+  // Cancel the newest order at the worst price of side s, the one with
+  // the least chance of ever trading; for holding a long run's book to a
+  // fixed size. Returns its id, 0 if the side is empty.
+  OrderId evict_worst(Side s);
+
+  // Re-queue a resting order at (px, qty): same id, node, index entry
+  // and tag, now at the back of level px (which may be its own level).
+  // One unlink and one link; no index or pool traffic. The caller makes
+  // sure px does not cross. Returns false if the id is not resting.
+  bool move(OrderId id, Price px, Qty qty, TimePoint ts);
+
+  // Take `by` off a resting order in place, keeping its time priority
+  // (partial cancel / external execution); removes it once nothing is
+  // left. Returns the qty still resting, 0 if it is gone or unknown.
+  Qty reduce(OrderId id, Qty by);
+
+  // Resting order by id (nullptr if not in the book); one index probe
+  RestingOrder* find(OrderId id) {
+    const OrderHandle h = index.find(id);
+    return h == kNullHandle ? nullptr : &nodes_[h];
+  }
+  const RestingOrder* find(OrderId id) const {
+    const OrderHandle h = index.find(id);
+    return h == kNullHandle ? nullptr : &nodes_[h];
+  }
+
+  // Resting orders as a dense list, for O(1) uniform sampling:
+  // k in [0, resting()) -> id. Order changes as orders come and go.
+  std::size_t resting() const { return live_.size(); }
+  OrderId     resting_at(std::size_t k) const { return nodes_[live_[k]].id; }
+
+  // Put the resting list in the order `ids` (resting_at(k) == ids[k]), so a
+  // restored book samples cancels exactly as the saved one did. ids must
+  // be every resting id, each once; otherwise throws std::invalid_argument
+  // (the list may be left reordered, the book itself is not touched).
+  void reorder_resting(const OrderId* ids, std::size_t n);
+
+  // Level access for the matching engine
+  RestingOrder&       front(LevelQueue& q)             { return nodes_[q.head]; }
+  const RestingOrder& front(const LevelQueue& q) const { return nodes_[q.head]; }
+  void pop_front(LevelQueue& q); // drop the head order from the level and the index
+
+  // Aggregated depth, all O(1) per level (see LevelQueue::total_qty):
+  //   depth:   the n best levels of side s, best-first (fewer if the side is shallower)
+  //   qty_at:  resting qty at exactly px, on whichever side holds it (0 if none)
+  //   qty_through: qty on side s at px or better, i.e. what a taker limited
+  //                at px could reach
+  void depth(Side s, std::size_t n, std::vector<DepthLevel>& out) const;
+  std::vector<DepthLevel> depth(Side s, std::size_t n) const {
+    std::vector<DepthLevel> out;
+    depth(s, n, out);
+    return out;
+  }
+  Qty qty_at(Price px) const {
+    if (const LevelQueue* q = bids.find(px)) return q->total_qty;
+    if (const LevelQueue* q = asks.find(px)) return q->total_qty;
+    return 0;
+  }
+  Qty qty_through(Side s, Price px) const;
+
+  // Price impact of a market order of `qty` on side `taker` (a buy eats
+  // the asks), from the level aggregates alone: read-only, no allocation,
+  // O(levels touched). For pre-trade / risk checks; the fills the engine
+  // would produce add up to exactly this.
+  ImpactEstimate estimate_impact(Side taker, Qty qty) const;
+
+  // The matcher took `qty` off the front order of q in place
+  void fill_front(LevelQueue& q, Qty qty) {
+    nodes_[q.head].qty -= qty;
+    q.total_qty -= qty;
+  }
+
+  // Call auctions (auction.hpp) take their executions off the orders' qty in
+  // place, through a level walk, then settle each level they touched:
+  // `taken` comes off its total and the orders now at 0 leave the book.
+  // front_only: those are all at the front of the line (time priority),
+  // so the walk stops at the first order with qty left.
+  void settle(Side s, Price px, Qty taken, bool front_only);
+
+  // Walk a level in time priority: f(const RestingOrder&), or
+  // f(RestingOrder&) on a non-const book
+  template <class F>
+  void for_each(const LevelQueue& q, F&& f) const {
+    for (OrderHandle h = q.head; h != kNullHandle; h = nodes_[h].next) f(nodes_[h]);
+  }
+  template <class F>
+  void for_each(const LevelQueue& q, F&& f) {
+    for (OrderHandle h = q.head; h != kNullHandle; h = nodes_[h].next) f(nodes_[h]);
+  }
 
   bool self_check() const;
-};
\ No newline at end of file
+
+  // Dirty levels, for incremental L2 snapshots. While tracking is on,
+  // every (side, price) whose orders or quantities change is appended
+  // here (possibly more than once) until clear_dirty(). Off by default:
+  // then mark_dirty() is a single predictable branch.
+  void track_dirty(bool on) { track_dirty_ = on; if (!on) clear_dirty(); }
+  void mark_dirty(Side s, Price px) { if (track_dirty_) dirty_[int(s)].push_back(px); }
+  const std::pmr::vector<Price>& dirty(Side s) const { return dirty_[int(s)]; }
+  void clear_dirty() { dirty_[0].clear(); dirty_[1].clear(); }
+
+private:
+  // Node pool: freed slots are recycled through free_ before the pool grows
+  std::pmr::vector<RestingOrder> nodes_;
+  std::pmr::vector<OrderHandle>  free_;
+  std::pmr::vector<OrderHandle>  live_; // every resting node, node.live_slot points back here
+
+  bool                    track_dirty_{false};
+  std::pmr::vector<Price> dirty_[2];      // by Side
+
+  template <Side S> void add_to(const Order& o);       // add_limit for one side
+  template <Side S> void remove_from(OrderHandle h);   // cancel for one side
+  template <Side S> OrderId evict_from();
+  template <Side S> void move_to(OrderHandle h, Price px, Qty qty, TimePoint ts);
+  template <Side S> void depth_of(std::size_t n, std::vector<DepthLevel>& out) const;
+  template <Side S> Qty  qty_through(Price px) const;
+  template <Side S> ImpactEstimate impact_of(Qty qty) const;  // S: the resting side
+  template <Side S> void settle_at(Price px, Qty taken, bool front_only);
+
+  OrderHandle alloc_node(const Order& o);
+  void        free_node(OrderHandle h);
+  void        link_back(LevelQueue& q, OrderHandle h);
+  void        unlink(LevelQueue& q, OrderHandle h);
+};
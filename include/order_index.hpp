@@ -0,0 +1,98 @@
+#pragma once
+#include "types.hpp"
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/*
+Flat OrderId -> value table (open addressing, Robin Hood linear
+probing). OrderIndex (id -> pool handle) is the book's; ExternalIdMap
+(exchange order ref -> our OrderId) is what feed handlers keep next to it.
+
+The home slot is the Fibonacci hash of the id (multiply by 2^64/phi,
+keep the top bits). Ids are dense and increasing, and the golden-ratio
+multiplier spreads any run of consecutive ids almost evenly over the
+table, so a lookup is one probe in the common case. Plain id & mask
+would be ideal for a single sliding window of live ids, but a book is
+not one window: orders resting deep in the book keep old ids alive, and
+once new ids wrap around onto their slots the probe runs grow into
+thousands (the lob_bench add/cancel benchmarks hit exactly that).
+Entries are 16 bytes (4 per cache line) and the table stays at most
+half full. kEmpty is the value that marks an empty slot and can't be
+stored.
+
+Robin Hood keeps every probe run ordered by home slot, so a lookup stops
+as soon as it passes where the id would have to be, and erase shifts the
+run back only until it meets an entry sitting at home. Short runs are
+what keep erase O(1) without tombstones.
+*/
+template <class V, V kEmpty>
+class FlatIndex {
+public:
+  explicit FlatIndex(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+    : slots_(kInitialSlots, Slot{}, mr), mask_(kInitialSlots - 1), shift_(64 - kInitialBits) {}
+
+  // Value for id, or kEmpty if absent
+  V find(OrderId id) const {
+    std::size_t i = home(id);
+    for (std::size_t d = 0;; ++d, i = (i + 1) & mask_) {
+      const Slot& s = slots_[i];
+      if (s.h == kEmpty || dist(i, s.id) < d) return kEmpty;
+      if (s.id == id) return s.h;
+    }
+  }
+  bool contains(OrderId id) const { return find(id) != kEmpty; }
+
+  // false (and no change) if id is already present
+  bool insert(OrderId id, V h) {
+    if (contains(id)) return false;
+    if (2 * (size_ + 1) > slots_.size()) grow();
+    place(Slot{ id, h });
+    ++size_;
+    return true;
+  }
+
+  // Removes id and returns its value (kEmpty if absent)
+  V erase(OrderId id);
+
+  std::size_t size()  const { return size_; }
+  bool        empty() const { return size_ == 0; }
+
+  // Room for n entries without growing (cheapest while still empty)
+  void reserve(std::size_t n);
+
+  // f(OrderId, V) for every entry, in slot order
+  template <class F>
+  void for_each(F&& f) const {
+    for (const Slot& s : slots_) if (s.h != kEmpty) f(s.id, s.h);
+  }
+
+private:
+  static constexpr unsigned    kInitialBits  = 10;
+  static constexpr std::size_t kInitialSlots = std::size_t{1} << kInitialBits;
+
+  struct Slot {
+    OrderId id{0};
+    V       h{kEmpty};   // kEmpty marks an empty slot
+  };
+
+  std::pmr::vector<Slot> slots_;
+  std::size_t            mask_;
+  unsigned               shift_;      // 64 - log2(slots)
+  std::size_t            size_{0};
+
+  std::size_t home(OrderId id) const {
+    return std::size_t((uint64_t(id) * 0x9E3779B97F4A7C15ull) >> shift_);
+  }
+  std::size_t dist(std::size_t slot, OrderId id) const { return (slot - home(id)) & mask_; }
+  void place(Slot s); // Robin Hood insert of a key known to be absent
+  void grow();
+  void rehash(std::size_t slots);
+};
+
+using OrderIndex    = FlatIndex<OrderHandle, kNullHandle>;
+using ExternalIdMap = FlatIndex<OrderId, OrderId{0}>;  // our ids start at 1
+
+// defined in order_index.cpp
+extern template class FlatIndex<OrderHandle, kNullHandle>;
+extern template class FlatIndex<OrderId, OrderId{0}>;
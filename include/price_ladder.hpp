@@ -0,0 +1,248 @@
+#pragma once
+#include "types.hpp"
+#include <algorithm>
+#include <bit>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+Flat price ladder: one slot per tick, slot i holds price base + i.
+A bitmap marks the non-empty slots so the best level (and the next one
+after it) is found with a couple of word scans instead of a tree walk.
+
+The window re-centers on the first price after the ladder empties, and
+doubles (keeping the live span in the middle) when a price falls off
+either end. Prices near the touch therefore all sit in one array.
+
+The window is capped at kMaxTicks slots. A level that would need a wider
+window (one outlier price far from the rest, e.g. in a feed) throws
+std::length_error before anything is allocated or changed; books with
+prices spread that wide belong on the map backend.
+*/
+template <class Level>
+class PriceLadder {
+public:
+  static constexpr int64_t kMaxTicks = int64_t{1} << 22; // window cap: 4M slots, ~100 MB of levels
+
+  explicit PriceLadder(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+    : levels_(mr), bits_(mr) {}
+
+  Level* find(Price px) {
+    const int64_t i = slot(px);
+    return (in_range(i) && test(i)) ? &levels_[i] : nullptr;
+  }
+  const Level* find(Price px) const {
+    const int64_t i = slot(px);
+    return (in_range(i) && test(i)) ? &levels_[i] : nullptr;
+  }
+
+  // Level at px, created (empty) if missing; std::length_error if that
+  // would take the window past kMaxTicks (the ladder is left as it was)
+  Level& get(Price px) {
+    int64_t i = slot(px);
+    if (!in_range(i)) { fit(px); i = slot(px); }
+    if (!test(i)) {
+      levels_[i] = Level{};
+      bits_[i >> 6] |= (uint64_t{1} << (i & 63));
+      if (n_ == 0) { lo_ = hi_ = i; }
+      else { if (i < lo_) lo_ = i; if (i > hi_) hi_ = i; }
+      ++n_;
+    }
+    return levels_[i];
+  }
+
+  void erase(Price px) {
+    const int64_t i = slot(px);
+    if (!in_range(i) || !test(i)) return;
+    bits_[i >> 6] &= ~(uint64_t{1} << (i & 63));
+    if (--n_ == 0) return;
+    if (i == lo_) lo_ = next_up(i + 1);
+    if (i == hi_) hi_ = next_down(i - 1);
+  }
+
+  bool        empty() const { return n_ == 0; }
+  std::size_t size()  const { return n_; }
+
+  // Extreme prices (ladder must not be empty)
+  Price lowest()  const { return base_ + lo_; }
+  Price highest() const { return base_ + hi_; }
+  Level& at_lowest()  { return levels_[lo_]; }
+  Level& at_highest() { return levels_[hi_]; }
+
+  // Visit non-empty levels low→high (Ascending) or high→low; f(Price, const Level&)
+  // may return false to stop early
+  template <bool Ascending, class F>
+  void walk(F&& f) const {
+    if (n_ == 0) return;
+    if constexpr (Ascending) {
+      for (int64_t i = lo_; i != -1 && i <= hi_; i = next_up(i + 1))
+        if (!call(f, base_ + i, levels_[i])) return;
+    } else {
+      for (int64_t i = hi_; i != -1 && i >= lo_; i = next_down(i - 1))
+        if (!call(f, base_ + i, levels_[i])) return;
+    }
+  }
+
+  // Best-first take for price-impact queries: from each non-empty level in
+  // turn, qty_of(level) or whatever is still wanted, until `want` is
+  // covered or the levels run out. Adds to cost (price * qty) and levels,
+  // sets worst to the last price touched, returns the qty taken.
+  template <bool Ascending, class QtyOf>
+  Qty take(Qty want, QtyOf&& qty_of, int64_t& cost, Price& worst, uint32_t& levels) const;
+
+  bool consistent() const;
+
+private:
+  static constexpr int64_t kInitialTicks = 1024; // multiple of 64
+
+  Price                      base_{0};
+  std::pmr::vector<Level>    levels_;
+  std::pmr::vector<uint64_t> bits_;
+  std::size_t                n_{0};
+  int64_t                    lo_{0}, hi_{0};  // slots of lowest / highest non-empty level
+
+  int64_t slot(Price px) const { return px - base_; }
+  bool in_range(int64_t i) const { return i >= 0 && i < int64_t(levels_.size()); }
+  bool test(int64_t i) const { return (bits_[i >> 6] >> (i & 63)) & 1u; }
+
+  int64_t next_up(int64_t i) const;   // first set slot >= i, or -1
+  int64_t next_down(int64_t i) const; // last set slot <= i, or -1
+  void    fit(Price px);              // re-center / grow so px has a slot
+
+  template <class F>
+  static bool call(F& f, Price px, const Level& l) {
+    if constexpr (std::is_same_v<decltype(f(px, l)), bool>) return f(px, l);
+    else { f(px, l); return true; }
+  }
+};
+
+template <class Level>
+int64_t PriceLadder<Level>::next_up(int64_t i) const {
+  if (i < 0) i = 0;
+  if (i >= int64_t(levels_.size())) return -1;
+  std::size_t w = std::size_t(i >> 6);
+  uint64_t word = bits_[w] & (~uint64_t{0} << (i & 63));
+  while (true) {
+    if (word) return int64_t(w << 6) + std::countr_zero(word);
+    if (++w == bits_.size()) return -1;
+    word = bits_[w];
+  }
+}
+
+template <class Level>
+int64_t PriceLadder<Level>::next_down(int64_t i) const {
+  if (i < 0) return -1;
+  if (i >= int64_t(levels_.size())) i = int64_t(levels_.size()) - 1;
+  std::size_t w = std::size_t(i >> 6);
+  const int sh = 63 - int(i & 63);
+  uint64_t word = (bits_[w] << sh) >> sh; // keep bits <= i
+  while (true) {
+    if (word) return int64_t(w << 6) + 63 - std::countl_zero(word);
+    if (w-- == 0) return -1;
+    word = bits_[w];
+  }
+}
+
+template <class Level>
+void PriceLadder<Level>::fit(Price px) {
+  if (n_ == 0) {
+    // nothing resting: just re-center the window on px
+    if (levels_.empty()) {
+      levels_.resize(kInitialTicks);
+      bits_.assign(kInitialTicks / 64, 0);
+    }
+    base_ = px - int64_t(levels_.size()) / 2;
+    return;
+  }
+
+  // grow until the live span plus px fits, keeping it centered
+  const Price lo = std::min(px, lowest());
+  const Price hi = std::max(px, highest());
+  int64_t n = int64_t(levels_.size());
+  while (n < 2 * (hi - lo + 1) && n <= kMaxTicks) n *= 2;
+  if (n > kMaxTicks)
+    throw std::length_error("PriceLadder: prices " + std::to_string(lo) + ".." + std::to_string(hi) +
+                            " span more than " + std::to_string(kMaxTicks / 2) +
+                            " ticks; use the map backend");
+
+  std::pmr::vector<Level>    levels(std::size_t(n), levels_.get_allocator());
+  std::pmr::vector<uint64_t> bits(std::size_t(n / 64), 0, bits_.get_allocator());
+  const Price base = lo + (hi - lo) / 2 - n / 2;
+  for (int64_t i = next_up(lo_); i != -1; i = next_up(i + 1)) {
+    const int64_t j = base_ + i - base;
+    levels[j] = levels_[i];
+    bits[std::size_t(j >> 6)] |= (uint64_t{1} << (j & 63));
+  }
+  lo_ += base_ - base;
+  hi_ += base_ - base;
+  base_ = base;
+  levels_.swap(levels);
+  bits_.swap(bits);
+}
+
+/*
+One pass over the bitmap, best-first: set bits are peeled off a word in
+a register, so moving to the next level costs a bit scan, not a search
+from the slot after the last one (as walk() does). `got` is a running sum
+rather than `want - taken`, so the per-level loads and adds never wait on
+each other, only the exit test reads them; the overshoot of the last
+level is handed back once at the end. Totals live in locals and are
+written back once: stores through the out references could alias the
+ladder and would force a reload every level.
+*/
+template <class Level>
+template <bool Ascending, class QtyOf>
+Qty PriceLadder<Level>::take(Qty want, QtyOf&& qty_of, int64_t& cost_out, Price& worst,
+                             uint32_t& levels_out) const {
+  if (n_ == 0 || want <= 0) return 0;
+  const Level* lv   = levels_.data();
+  const Price  base = base_;
+  Qty      got    = 0;
+  int64_t  cost   = 0;
+  uint32_t levels = 0;
+  Price    px     = 0;
+
+  const int64_t first = Ascending ? lo_ : hi_;
+  const int64_t last  = Ascending ? hi_ : lo_;
+  std::size_t w = std::size_t(first >> 6);
+  // the first word starts at the best level
+  uint64_t m = Ascending ? bits_[w] & (~uint64_t{0} << (first & 63))
+                         : bits_[w] & (~uint64_t{0} >> (63 - (first & 63)));
+  for (;;) {
+    const int64_t w0 = int64_t(w) << 6;
+    while (m) {
+      const int b = Ascending ? std::countr_zero(m) : 63 - std::countl_zero(m);
+      m = Ascending ? m & (m - 1) : m & ~(uint64_t{1} << b);
+      const Qty q = qty_of(lv[w0 + b]);
+      px    = base + w0 + b;
+      got  += q;
+      cost += px * q;
+      ++levels;
+      if (got >= want) {
+        cost -= px * (got - want);   // the last level is only taken in part
+        got   = want;
+        break;
+      }
+    }
+    if (got == want || (Ascending ? w0 + 63 >= last : w0 <= last)) break;
+    m = bits_[Ascending ? ++w : --w];
+  }
+  cost_out   += cost;
+  levels_out += levels;
+  worst = px;
+  return got;
+}
+
+template <class Level>
+bool PriceLadder<Level>::consistent() const {
+  std::size_t n = 0;
+  for (std::size_t w = 0; w < bits_.size(); ++w) {
+    n += std::size_t(std::popcount(bits_[w]));
+  }
+  if (n != n_) return false;
+  if (n_ == 0) return true;
+  return next_up(0) == lo_ && next_down(int64_t(levels_.size()) - 1) == hi_;
+}
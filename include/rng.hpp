@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// splitmix64: seeds the bigger generators from one 64-bit value
+inline uint64_t splitmix64(uint64_t& x) {
+  uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// 53 random bits -> double in [0, 1)
+inline double to_unit(uint64_t x) { return double(x >> 11) * 0x1.0p-53; }
+
+// 32-bit fraction (as packed in SimEvent) -> double in [0, 1)
+inline double to_unit32(uint32_t x) { return double(x) * 0x1.0p-32; }
+
+/*
+Four xoshiro256** generators stepped in lock-step (lane k is lane k-1
+jumped ahead 2^128 draws, so the lanes never overlap). The state is kept
+lane-wise in arrays, which lets the compiler turn one step of all four
+lanes into a handful of vector instructions.
+
+The output stream is lane 0, 1, 2, 3, lane 0, ... so it is fixed by the
+seed alone, however the caller chunks its requests.
+*/
+class Xoshiro256x4 {
+public:
+  static constexpr std::size_t kLanes = 4;
+
+  explicit Xoshiro256x4(uint64_t seed) {
+    uint64_t sm = seed;
+    uint64_t s[4];
+    for (auto& w : s) w = splitmix64(sm);
+    for (std::size_t l = 0; l < kLanes; ++l) {
+      s0_[l] = s[0]; s1_[l] = s[1]; s2_[l] = s[2]; s3_[l] = s[3];
+      jump(s);
+    }
+  }
+
+  // Writes kLanes * steps outputs
+  void fill(uint64_t* out, std::size_t steps) {
+    for (std::size_t i = 0; i < steps; ++i, out += kLanes) {
+      for (std::size_t l = 0; l < kLanes; ++l) {
+        out[l] = rotl(s1_[l] * 5, 7) * 9;
+        const uint64_t t = s1_[l] << 17;
+        s2_[l] ^= s0_[l];
+        s3_[l] ^= s1_[l];
+        s1_[l] ^= s2_[l];
+        s0_[l] ^= s3_[l];
+        s2_[l] ^= t;
+        s3_[l] = rotl(s3_[l], 45);
+      }
+    }
+  }
+
+  // Raw state, word-major (s[w][lane]): what a checkpoint saves
+  struct State { uint64_t s[4][kLanes]; };
+  State state() const {
+    State st;
+    for (std::size_t l = 0; l < kLanes; ++l) {
+      st.s[0][l] = s0_[l]; st.s[1][l] = s1_[l]; st.s[2][l] = s2_[l]; st.s[3][l] = s3_[l];
+    }
+    return st;
+  }
+  void set_state(const State& st) {
+    for (std::size_t l = 0; l < kLanes; ++l) {
+      s0_[l] = st.s[0][l]; s1_[l] = st.s[1][l]; s2_[l] = st.s[2][l]; s3_[l] = st.s[3][l];
+    }
+  }
+
+private:
+  alignas(32) uint64_t s0_[kLanes];
+  alignas(32) uint64_t s1_[kLanes];
+  alignas(32) uint64_t s2_[kLanes];
+  alignas(32) uint64_t s3_[kLanes];
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  // Advance a single xoshiro256 state by 2^128 steps
+  static void jump(uint64_t s[4]) {
+    static constexpr uint64_t J[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull,
+                                       0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+    uint64_t t[4] = {0, 0, 0, 0};
+    for (uint64_t j : J) {
+      for (int b = 0; b < 64; ++b) {
+        if (j & (uint64_t{1} << b)) { t[0] ^= s[0]; t[1] ^= s[1]; t[2] ^= s[2]; t[3] ^= s[3]; }
+        const uint64_t u = s[1] << 17;
+        s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3]; s[2] ^= u;
+        s[3] = rotl(s[3], 45);
+      }
+    }
+    s[0] = t[0]; s[1] = t[1]; s[2] = t[2]; s[3] = t[3];
+  }
+};
+
+/*
+Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+1, 2, 3"): a keyed bijection on 128-bit counters. Output for a counter
+depends only on (key, counter), so any draw can be recomputed on its own
+and blocks can be produced in any order or on any thread.
+*/
+struct Philox4x32 {
+  static void block(const uint32_t ctr[4], uint64_t key, uint32_t out[4]) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = uint32_t(key), k1 = uint32_t(key >> 32);
+    for (int r = 0; r < 10; ++r) {
+      const uint64_t p0 = uint64_t(0xD2511F53u) * c0;
+      const uint64_t p1 = uint64_t(0xCD9E8D57u) * c2;
+      const uint32_t n0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+      const uint32_t n2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+      c1 = uint32_t(p1);
+      c3 = uint32_t(p0);
+      c0 = n0;
+      c2 = n2;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+  }
+
+  // One block as two 64-bit words; counter = (lo64, c2, c3)
+  static void words(uint64_t key, uint64_t lo64, uint32_t c2, uint32_t c3, uint64_t out[2]) {
+    const uint32_t ctr[4] = { uint32_t(lo64), uint32_t(lo64 >> 32), c2, c3 };
+    uint32_t o[4];
+    block(ctr, key, o);
+    out[0] = uint64_t(o[0]) | (uint64_t(o[1]) << 32);
+    out[1] = uint64_t(o[2]) | (uint64_t(o[3]) << 32);
+  }
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/*
+Next-event scheduler: which of k independent processes fires next, and
+when. Each process id in [0, k) has at most one pending due time; the
+pending ones sit in a binary min-heap, with pos_ mapping id -> heap slot
+so a process can be rescheduled or cancelled in place. schedule(),
+cancel() and pop() are O(log k), top() is O(1).
+
+Ties on the due time go to the lower id, so for a given sequence of
+calls the firing order is fully deterministic.
+
+The event generator races its arrival processes with one of these (one
+per event type, plus the regime switch), the Simulator its timers.
+*/
+class EventScheduler {
+public:
+  using Id = uint32_t;
+  static constexpr TimePoint kNever = std::numeric_limits<TimePoint>::infinity();
+
+  explicit EventScheduler(std::size_t processes = 0) { resize(processes); }
+
+  // Ids [0, processes), nothing pending
+  void resize(std::size_t processes);
+  void clear();
+
+  // Set id's due time, whether or not it was pending
+  void schedule(Id id, TimePoint t);
+  // Drop id's pending time; false if it had none
+  bool cancel(Id id);
+
+  bool      pending(Id id) const { return pos_[id] != kNone; }
+  TimePoint due(Id id) const     { return pending(id) ? heap_[pos_[id]].t : kNever; }
+
+  bool        empty() const { return heap_.empty(); }
+  std::size_t size() const  { return heap_.size(); }
+  std::size_t processes() const { return pos_.size(); }
+
+  // Earliest pending process and its time (not empty())
+  Id        top() const      { return heap_.front().id; }
+  TimePoint top_time() const { return heap_.front().t; }
+  // Remove the earliest pending process and return it (not empty())
+  Id pop();
+
+private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  struct Entry {
+    TimePoint t;
+    Id        id;
+  };
+  static bool before(const Entry& a, const Entry& b) {
+    return a.t < b.t || (a.t == b.t && a.id < b.id);
+  }
+
+  void sift_up(std::size_t i);
+  void sift_down(std::size_t i);
+  void put(std::size_t i, const Entry& e) { heap_[i] = e; pos_[e.id] = uint32_t(i); }
+  void remove_at(std::size_t i);
+
+  std::vector<Entry>    heap_;
+  std::vector<uint32_t> pos_;   // id -> heap index, kNone when not pending
+};
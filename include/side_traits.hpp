@@ -0,0 +1,36 @@
+#pragma once
+#include "types.hpp"
+#include <functional>
+#include <limits>
+
+/*
+Everything that differs between the buy and the sell side, resolved at
+compile time. Book sides and the matcher are written once as
+template <Side S> and pick their direction from here, so each
+instantiation is a straight-line loop with no runtime Side branches.
+
+For a resting side S, "better" means closer to the touch (higher for
+bids, lower for asks). For a taker on side S, crosses(limit, px) says
+whether a resting level at px on the other side is marketable.
+*/
+template <Side S> struct SideTraits;
+
+template <> struct SideTraits<Side::Buy> {
+  using Cmp = std::greater<Price>;               // bids: best = highest
+  static constexpr Side kOpposite   = Side::Sell;
+  static constexpr bool kBestIsHigh = true;
+  static constexpr Price kNoLimit   = std::numeric_limits<Price>::max(); // market buy
+  static constexpr bool better(Price a, Price b)        { return a > b; }
+  static constexpr bool crosses(Price limit, Price ask) { return limit >= ask; }
+};
+
+template <> struct SideTraits<Side::Sell> {
+  using Cmp = std::less<Price>;                  // asks: best = lowest
+  static constexpr Side kOpposite   = Side::Buy;
+  static constexpr bool kBestIsHigh = false;
+  static constexpr Price kNoLimit   = std::numeric_limits<Price>::min(); // market sell
+  static constexpr bool better(Price a, Price b)        { return a < b; }
+  static constexpr bool crosses(Price limit, Price bid) { return limit <= bid; }
+};
+
+constexpr Side opposite(Side s) { return s == Side::Buy ? Side::Sell : Side::Buy; }
@@ -1,126 +1,129 @@
 #pragma once
 #include "matching_engine.hpp"
 #include "metrics.hpp"
+#include "sim_config.hpp"
+#include "event_gen.hpp"
+#include "spsc_ring.hpp"
+#include "event_log.hpp"
+#include "trade_log.hpp"
+#include "snapshot.hpp"
+#include "scheduler.hpp"
+#include "strategies.hpp"
+#include "checkpoint.hpp"
+#include "auction.hpp"
 #include <cstddef>
+#include <memory>
 #include <optional>
-#include <random>
 #include <vector>
 #include <array>
-#include <unordered_map>
 
-enum class Regime : uint8_t { Low = 0, High = 1 };
-
-enum class EventType : uint8_t { LimitBuy, LimitSell, MktBuy, MktSell, Cancel };
-
-struct SimEvent {
-  EventType type;
-  TimePoint ts;
-  Side side;
-  Qty qty = 0;
-  std::optional<Price> px;           // for limit orders
-  std::optional<OrderId> cancel_id;  // for cancel events
-};
-
-struct RegimeMix {
-  // event mix (probabilities); Cancel is implied as 1 - (sum of these four)
-  double p_limit_buy  {0.0};
-  double p_limit_sell {0.0};
-  double p_mkt_buy    {0.0};
-  double p_mkt_sell   {0.0};
-  double p_cancel     {0.0};
-};
-
-struct RegimeParams {
-  double    lambda = 1000.0;  // events per second for this regime
-  RegimeMix mix{};
-};
-
-struct RegimeConfig {
-  double      p_LL  = 0.995;         // stay in Low
-  double      p_HH  = 0.990;         // stay in High
-  RegimeParams low{};                // low-vol regime
-  RegimeParams high{};               // high-vol regime
-};
-
-struct SimConfig {
-  // RNG / runtime
-  uint64_t seed{0};
-  size_t   max_events{0};
-  uint32_t snapshot_every{0};
-
-  // regime switching
-  struct {
-    double       p_LL{0.0};
-    double       p_HH{0.0};
-    RegimeParams low{};
-    RegimeParams high{};
-  } regime;
-
-  // qty distributions
-  double mean_limit_qty{0.0};
-  double mean_market_qty{0.0};
-
-  // price model
-  int    initial_mid_ticks{0};
-  int    min_price_ticks{0};
-  int    max_offset_ticks{0};
-  double geolap_alpha{0.0};    
-  double keep_cross_prob{0.0};
-
-  // logging
-  bool   log_trades{false};
-};
-
-class Simulator {
+/*
+One book, one engine, one event stream. Telemetry is the observer Obs
+(see "Simulator observers" in metrics.hpp): Simulator reports everything
+in SimStats, BareSimulator observes nothing, for raw throughput. Both are
+instantiated in sim.cpp.
+*/
+template <class Obs>
+class BasicSimulator {
 public:
-  explicit Simulator(const SimConfig& cfg);
-
-  void run();
-
-  const MatchingEngine& engine() const { return me_; }
-  const OrderBook&      book()   const { return ob_; }
-  TimePoint             now()    const { return t_curr_; }
-  Regime                regime() const { return regime_; }
+  explicit BasicSimulator(const SimConfig& cfg);
+
+  void run();            // run to max_events, printing progress and a report
+  SimStats simulate();   // same run, silent; returns the telemetry
+  SimStats stats() const;
+
+  // Resolve and execute one event drawn elsewhere (multi-symbol / pipelined
+  // drivers); the driver owns the generator, this Simulator's gen_ is unused
+  void apply(SimEvent e);
+
+  // With cfg.auction_interval set, the flow is matched in periodic call
+  // auctions instead (auction.hpp): limit and market orders are collected
+  // as they arrive and a timer uncrosses them, with the book, every
+  // auction_interval sim seconds. Cancels sample the book only, so an
+  // order is a cancel target once it rests after its auction. Agents'
+  // intents still trade on arrival. Such runs write no event log
+  // (std::invalid_argument): replay matches continuously.
+
+  // With cfg.max_resting / max_depth_ticks set, the run is bounded: after
+  // every event the book is cut back to that many ticks from mid / that
+  // many orders, farthest first. With max_resting, memory stays flat
+  // however many events are run (1e9 and more). Evictions are logged as
+  // Cancels, so bounded runs replay from their event log.
+
+  // Trade `agents` in this book (see strategies.hpp); not owned, must
+  // outlive the run. Agents' orders are not in the event log, so a run
+  // with agents does not replay from it.
+  void attach(AgentDriver& agents) { agents_ = &agents; }
+  AgentStats agent_stats() const;
+
+  // Checkpoints (checkpoint.hpp). checkpoint() captures the market as it
+  // stands: after run() / simulate() the generator has drawn exactly the
+  // events executed, so the state is consistent between any two runs.
+  // Not with agents attached (their state is theirs; std::logic_error).
+  // Orders collected for a call auction are not saved.
+  //
+  // restore() loads one into a Simulator that has not run yet (else
+  // std::logic_error); the next run then draws max_events more events
+  // from there, with fresh telemetry:
+  //   Resume::Continue  the checkpoint's own draws, as if the saved run
+  //                     had simply gone on (needs its seed, stream and
+  //                     rng, std::invalid_argument otherwise, and the
+  //                     same flow parameters to be exact)
+  //   Resume::Fork      fresh clocks and draws from this config's seed,
+  //                     at the checkpoint's time and regime: many runs
+  //                     (seeds, parameters) sharing one warmed-up book
+  // Event logs of a restored run start mid-stream, so they replay only on
+  // top of the same checkpoint.
+  Checkpoint checkpoint() const;
+  void       restore(const Checkpoint& ck, Resume how = Resume::Continue);
+
+  const MatchingEngine& engine()   const { return me_; }
+  const OrderBook&      book()     const { return ob_; }
+  const Obs&            observer() const { return obs_; }
+  TimePoint             now()      const { return t_curr_; }
+  Regime                regime()   const { return regime_; }
 
 private:
   // State
   SimConfig     cfg_;
   OrderBook     ob_;
   MatchingEngine me_;
-  std::mt19937_64 rng_;
-  TimePoint     t_curr_{0.0};
+  EventGenerator gen_;      // book-independent draws, a batch at a time
+  EventBatch     batch_;
+  std::unique_ptr<EventLogWriter> log_;  // set when cfg.event_log is given
+  std::unique_ptr<TradeLogger>    trades_; // set when cfg.log_trades is on
+  std::unique_ptr<L2Snapshotter>  snaps_;  // set when cfg.snapshot_path is given
+  std::unique_ptr<CallAuction>    auction_; // set when cfg.auction_interval > 0
+  TimePoint     t_curr_{0.0};     // sim time of the event being handled
   Regime        regime_{Regime::Low};
 
-  // Telemetry (counts and aggregates used by sim.cpp)
-  size_t n_events_   = 0;
-  size_t n_limits_   = 0;
-  size_t n_markets_  = 0;
-  size_t n_cancels_  = 0;
-  size_t n_trades_   = 0;
-
-  // ---- Limit-order offset / fill-by-distance telemetry ----
-  std::array<uint64_t, 5> lim_total_  {0,0,0,0,0};  // how many limits created per distance bucket
-  std::array<uint64_t, 5> lim_filled_ {0,0,0,0,0};  // how many of those ever got at least one fill
-  std::unordered_map<OrderId, int> lim_bucket_by_id_; // order id -> bucket
-
-  // Optional (if you haven’t added these yet) for average absolute offset & histogram:
-  uint64_t limit_offset_count_   = 0;
-  uint64_t limit_offset_abs_sum_ = 0;
-  std::array<uint64_t, 64> limit_offset_hist_{};     // simple histogram of |offset| in ticks
-
-  // Mid tracking & drawdown (if not already present)
-  uint64_t mid_samples_ = 0;
-  double   sum_mid_     = 0.0;
-  int      peak_mid_    = 0;
-  int      max_drawdown_ = 0;
-
-  // Market-order slippage accumulators (if not already present)
-  double   mo_buy_slip_  = 0.0;  uint64_t mo_buy_qty_  = 0;
-  double   mo_sell_slip_ = 0.0;  uint64_t mo_sell_qty_ = 0;
-
-  // optional (you used them; add if not present)
-  uint64_t vol_traded_{0};
-  double sum_spread_ = 0.0;
+  // Timers, raced in sim time against the event stream (see advance)
+  enum Timer : EventScheduler::Id { kMetricsWindow, kAgentTimers, kAuction, kTimers };
+  EventScheduler timers_{kTimers};
+
+  // Agents (attach): their intents, and what they are told next
+  AgentDriver*           agents_ = nullptr;
+  IntentBuffer           intents_, running_;
+  std::vector<Fill>      tape_;              // fills since the last book update
+  std::vector<AgentFill> own_fills_;
+  std::vector<OrderAck>  acks_;
+  ExternalIdMap          agent_orders_;      // resting agent order -> AgentId + 1
+  AgentId                taker_agent_ = kNoAgent; // whose intent is executing
+  uint64_t               agent_intents_ = 0;
+
+  // Call auctions (cfg.auction_interval): uncrosses run, those that traded
+  uint64_t auctions_ = 0, auctions_traded_ = 0, auction_vol_ = 0;
+  LOB_LAT(LatencyProfile lat_{cfg_.latency_sample};) // per-stage / per-type latency
+
+  Obs      obs_;                // telemetry: fixed-size, whatever the run length
+  size_t   n_events_{0};
+  uint64_t events_before_{0};   // events behind the checkpoint restored from
+  uint64_t allocs_at_half_{0};  // arena allocations at max_events/2
+  uint64_t bytes_at_half_{0};   // and arena bytes in use then
+
+  // Bounded memory (cfg.max_resting / max_depth_ticks), see trim_book
+  bool     bounded_{false};
+  uint64_t evicted_{0};         // resting orders dropped to stay in bounds
 
   inline int mid_ticks() const {
     if (ob_.bids.empty() || ob_.asks.empty())
@@ -128,37 +131,43 @@ private:
     return (ob_.best_bid() + ob_.best_ask()) / 2;
   }
 
-  // helper: bucket by offset k
-  static int bucket_for_offset(int k) {
-    if (k <= 0)  return 0;
-    if (k <= 2)  return 1;
-    if (k <= 5)  return 2;
-    if (k <= 10) return 3;
-    return 4;
-  }
+  // Move sim time to t, first ringing every timer due at or before it
+  void advance(TimePoint t);
 
-  // live-id tracking for Cancel sampling
-  std::vector<OrderId>               live_ids_;
-  std::unordered_map<OrderId,size_t> pos_;
-
-  // RNG draws
-  double draw_exp(double lambda);
-  Qty    draw_geometric_mean(double mean);
-  int    draw_two_sided_offset();
-
-  // Regime & events
-  void             maybe_switch_regime();
-  const RegimeMix& mix_for(Regime r) const;
-  SimEvent         next_event();
+  // Events: resolve a pre-drawn batch row against the current book
+  void resolve(SimEvent& e);
 
   // Pricing helpers
   Price  current_mid() const;
-  Price  decide_limit_price(Side s);
+  Price  decide_limit_price(Side s, int off, double u_keep);
+
+  // Cancel target: uniform over the book's resting orders (u in [0,1))
+  OrderId sample_live(double u);
+
+  void execute(const SimEvent& e);  // engine / book work for a resolved event
+  void record(const Fill& f);       // every fill, flow or agent: observer, logs, agents
+  void credit_resting(const Fill& f, OrderId id, Side side); // id: a resting agent order
+  void clear_tag(OrderId id);       // of a resting or collected order
+  void trim_book(const SimEvent& cause); // bounded runs: evict down to the limits
+
+  // Agents: tell them what happened (book_changed: a flow event executed)
+  // and run what they send back, round by round
+  void start_agents();
+  void notify_agents(bool book_changed);
+  void run_intents();
+  void run_intent(const QueuedIntent& q);
+  AgentUpdate agent_update(bool book_changed) const;
+  void account(const SimEvent& e);  // observer's per-event hook after it
+  LOB_LAT(void timed(SimEvent& e);) // resolve + execute + account, each stage clocked
+  LOB_LAT(void timed_fill(EventGenerator& g, EventBatch& b, std::size_t n);)
+  void loop(bool progress);
+  void loop_serial(bool progress);
+  template <WaitStrategy W> void loop_pipelined(bool progress);
+  void step(size_t i, SimEvent e, bool progress);
+};
 
-  // Live id helpers
-  void   live_add_if_resting(OrderId id);
-  void   live_remove(OrderId id);
-  OrderId sample_live();
+using Simulator     = BasicSimulator<SimTelemetry>;
+using BareSimulator = BasicSimulator<NoTelemetry>;
 
-  void execute(const SimEvent& e);
-};
+extern template class BasicSimulator<SimTelemetry>;
+extern template class BasicSimulator<NoTelemetry>;
@@ -0,0 +1,141 @@
+#pragma once
+#include "auction.hpp"      // Allocation
+#include "order_book.hpp"   // BookBackend
+#include "spsc_ring.hpp"    // WaitStrategy
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Raw draw source for the event generator (see event_gen.hpp)
+enum class RngKind : uint8_t { Xoshiro, Philox };
+
+// Trade log (see trade_log.hpp): file format, and what to do when the
+// writer can't keep up
+enum class TradeLogFormat : uint8_t { Text, Binary };
+enum class Backpressure   : uint8_t { Block, Drop };
+
+enum class Regime : uint8_t { Low = 0, High = 1 };
+
+enum class EventType : uint8_t { LimitBuy, LimitSell, MktBuy, MktSell, Cancel };
+
+/*
+One event, packed into 24 bytes (no std::optional, no double ts).
+
+The same record travels the whole way: the generator emits it with the
+book-independent draws (`draw`), the simulator resolves it in place
+against the book (`px` or `cancel_id`, and sets kResolved), and that
+form is what gets executed and logged. Which union member is live
+follows from type and flags:
+  - unresolved:          draw
+  - resolved Limit*:     px
+  - resolved Cancel:     cancel_id (0 = nothing to cancel)
+  - Mkt*:                nothing
+*/
+struct SimEvent {
+  static constexpr uint8_t kResolved = 1;
+
+  int64_t   ts_ns = 0;                  // event time, integer nanoseconds
+  union {
+    Price   px;                         // limit price, ticks
+    OrderId cancel_id;                  // cancel target
+    struct {
+      int32_t  offset;                  // signed ticks from mid (limits and cancel fallback)
+      uint32_t pick;                    // uniform in units of 2^-32: keep-cross coin / cancel pick
+    } draw;
+  };
+  uint32_t  qty   = 0;
+  EventType type  = EventType::Cancel;
+  Side      side  = Side::Buy;          // Cancel: side of the fallback limit
+  Regime    regime = Regime::Low;       // regime the event was drawn in
+  uint8_t   flags = 0;
+
+  SimEvent() : px(0) {}
+  bool resolved() const { return flags & kResolved; }
+  TimePoint ts() const { return TimePoint(ts_ns) * 1e-9; }
+};
+static_assert(sizeof(SimEvent) == 24, "SimEvent should stay packed");
+
+struct RegimeMix {
+  // event mix (probabilities); Cancel is implied as 1 - (sum of these four)
+  double p_limit_buy  {0.0};
+  double p_limit_sell {0.0};
+  double p_mkt_buy    {0.0};
+  double p_mkt_sell   {0.0};
+  double p_cancel     {0.0};
+};
+
+struct RegimeParams {
+  double    lambda = 1000.0;  // events per second for this regime
+  RegimeMix mix{};
+};
+
+struct RegimeConfig {
+  double      p_LL  = 0.995;         // stay in Low
+  double      p_HH  = 0.990;         // stay in High
+  RegimeParams low{};                // low-vol regime
+  RegimeParams high{};               // high-vol regime
+};
+
+struct SimConfig {
+  // RNG / runtime
+  uint64_t seed{0};
+  size_t   max_events{0};
+  uint32_t snapshot_every{0};
+  std::string snapshot_path;         // non-empty: L2 frames every snapshot_every events (snapshot.hpp)
+  uint32_t snapshot_depth{10};       // levels per side
+  uint32_t snapshot_full_every{10};  // one full frame per this many, deltas between
+  size_t   gen_batch{4096};     // events drawn per generator batch
+  uint32_t latency_sample{64};  // LOB_LATENCY builds: time one event in this many
+  double   metrics_window{1.0}; // sim seconds per events/sec window (0 = no windows)
+  RngKind  rng{RngKind::Xoshiro}; // Philox: draws keyed by (seed, stream, event index)
+  uint32_t stream{0};           // Philox stream id; independent runs under one seed
+
+  // pipelining: draws on a producer thread, book work on the caller
+  bool         pipeline{false};
+  WaitStrategy pipeline_wait{WaitStrategy::Yield};
+  size_t       pipeline_ring{1 << 14};  // ring capacity, events
+
+  // regime switching
+  struct {
+    double       p_LL{0.0};
+    double       p_HH{0.0};
+    RegimeParams low{};
+    RegimeParams high{};
+  } regime;
+
+  // qty distributions
+  double mean_limit_qty{0.0};
+  double mean_market_qty{0.0};
+
+  // price model
+  int    initial_mid_ticks{0};
+  int    min_price_ticks{0};
+  int    max_offset_ticks{0};
+  double geolap_alpha{0.0};    
+  double keep_cross_prob{0.0};
+
+  // book
+  BookBackend book_backend{BookBackend::Map}; // level container (A/B under the same seed)
+
+  // bounded memory for long runs (0 = unbounded): after each event, orders
+  // resting more than max_depth_ticks from mid are dropped, then the book
+  // is trimmed to max_resting orders, farthest from mid first.
+  // max_resting holds the book, its index and its node pool at a fixed
+  // size; max_depth_ticks alone only bounds the price span (ladder width).
+  size_t max_resting{0};
+  int    max_depth_ticks{0};
+
+  // matching: continuous (0), or a call auction every auction_interval sim
+  // seconds, the flow collected in between (auction.hpp)
+  double     auction_interval{0.0};
+  Allocation auction_allocation{Allocation::TimePriority};
+
+  // logging
+  bool   log_trades{false};
+  std::string    trade_log;                              // "" = stdout
+  TradeLogFormat trade_log_format{TradeLogFormat::Text};
+  Backpressure   trade_log_policy{Backpressure::Block};
+  std::string event_log;          // non-empty: write resolved events here (see event_log.hpp)
+  bool   event_log_fills{false};  // also write <event_log>.fills
+};
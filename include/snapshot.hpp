@@ -0,0 +1,103 @@
+#pragma once
+#include "event_log.hpp"
+#include "order_book.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+L2 snapshots: the top N price levels of each side, aggregated (total qty
+and order count per level), taken every SimConfig::snapshot_every events.
+
+Frames are incremental. Every full_every-th frame (the first one
+included) is a full frame: the whole top-N view of both sides. The ones
+in between are delta frames holding only the levels of that view that
+differ from the previous frame: new qty/count for a level that changed
+or came into view, qty 0 / count 0 for one that left it (emptied, or
+pushed below level N). Applying a delta to the previous view gives the
+current top-N view exactly, so a reader can start at any full frame.
+
+Level totals come from the book's per-level aggregates (OrderBook::depth),
+so a frame costs O(N) whatever the queue lengths; a side with nothing on
+the book's dirty-level list (OrderBook::track_dirty) since the previous
+frame is not even walked.
+
+File layout, columnar per frame so a loader can slice columns straight
+out of the file (all fields native-endian, see LogHeader::byte_order):
+
+  LogHeader     magic "LOBL2SN1", record_size = kRowBytes (bytes per row,
+                summed over the columns)
+  per frame:
+    FrameHeader 24 bytes: seq (events applied), ts_ns, rows, kind
+    int64_t     px[rows]
+    int64_t     qty[rows]
+    uint32_t    count[rows]
+    uint8_t     side[rows]      0 = bid, 1 = ask
+    zero padding up to a multiple of 8 bytes
+
+Rows are bids best-first, then asks best-first.
+*/
+
+inline constexpr char kL2Magic[8] = {'L','O','B','L','2','S','N','1'};
+
+enum class FrameKind : uint8_t { Full = 0, Delta = 1 };
+
+struct FrameHeader {
+  uint64_t  seq;       // events applied when the frame was taken
+  int64_t   ts_ns;     // sim time of the last of those events
+  uint32_t  rows;
+  FrameKind kind;
+  uint8_t   pad[3] = {0, 0, 0};
+};
+static_assert(sizeof(FrameHeader) == 24, "FrameHeader is 24 bytes on disk");
+
+class L2Snapshotter {
+public:
+  static constexpr uint32_t kRowBytes = 8 + 8 + 4 + 1;
+
+  // depth: levels per side; full_every: one full frame per this many frames
+  // (1 = every frame is full).
+  L2Snapshotter(const std::string& path, std::size_t depth, uint32_t full_every,
+                std::size_t buffer_bytes = 1 << 20);
+  ~L2Snapshotter();   // flushes; errors there are swallowed, call close() to see them
+
+  L2Snapshotter(const L2Snapshotter&) = delete;
+  L2Snapshotter& operator=(const L2Snapshotter&) = delete;
+
+  // Write the next frame for `ob`. Turns on the book's dirty tracking and
+  // clears the list once the frame is built.
+  void capture(OrderBook& ob, uint64_t seq, int64_t ts_ns);
+  void close();
+
+  uint64_t frames() const      { return frames_; }
+  uint64_t full_frames() const { return full_; }
+  uint64_t rows() const        { return rows_; }
+
+private:
+  using Level = DepthLevel;
+
+  template <Side S> void view(const OrderBook& ob, bool changed, std::vector<Level>& out);
+  template <Side S> void diff(const std::vector<Level>& prev, const std::vector<Level>& cur);
+  void row(Side s, const Level& l);
+  void write_frame(uint64_t seq, int64_t ts_ns, FrameKind kind);
+  void put(const void* p, std::size_t n);
+  void flush();
+
+  std::size_t depth_;
+  uint32_t    full_every_;
+
+  std::vector<Level> view_[2], next_[2];  // previous / current top-N, by Side
+
+  // current frame, column by column
+  std::vector<int64_t>  px_, qty_;
+  std::vector<uint32_t> count_;
+  std::vector<uint8_t>  side_;
+
+  int               fd_ = -1;
+  std::string       path_;
+  std::vector<char> buf_;
+  std::size_t       used_ = 0;
+
+  uint64_t frames_ = 0, full_ = 0, rows_ = 0;
+};
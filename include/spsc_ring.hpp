@@ -0,0 +1,149 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+// How a blocking push()/pop() waits when the ring is full/empty
+enum class WaitStrategy : uint8_t {
+  Spin,   // busy-poll with a CPU pause: lowest latency, burns a core
+  Yield,  // short spin, then std::this_thread::yield() between polls
+  Park,   // short spin and yield, then sleep on the index (futex) until woken
+};
+
+/*
+Bounded single-producer / single-consumer ring.
+
+One thread pushes, one thread pops; no locks, no CAS. The producer owns
+tail_ and the consumer owns head_, each on its own cache line, and each
+side keeps a private copy of the other's index so it only re-reads the
+shared one when the ring looks full (producer) or empty (consumer).
+Capacity is rounded up to a power of two so wrap-around is a mask.
+
+The wait strategy is a template parameter so the fast paths carry no
+branches for it. Only Park pays anything extra on the fast path: after
+publishing an index, a side checks (behind a full fence) whether the
+other side went to sleep on it and wakes it if so.
+*/
+template <class T, WaitStrategy W = WaitStrategy::Yield>
+class SpscRing {
+public:
+  explicit SpscRing(std::size_t capacity) {
+    if (capacity < 2) throw std::invalid_argument("SpscRing capacity must be >= 2");
+    std::size_t c = 1;
+    while (c < capacity) c <<= 1;
+    mask_ = c - 1;
+    buf_ = std::make_unique<T[]>(c);
+  }
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  // ---- producer side ----
+  bool try_push(const T& v) {
+    const std::size_t t = tail_.load(std::memory_order_relaxed);
+    if (t - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (t - head_cache_ > mask_) return false; // full
+    }
+    buf_[t & mask_] = v;
+    publish(tail_, t + 1, consumer_parked_);
+    return true;
+  }
+
+  void push(const T& v) {
+    for (unsigned n = 0; !try_push(v); ++n) {
+      wait(n, producer_parked_, head_, [&] {
+        head_cache_ = head_.load(std::memory_order_acquire);
+        return tail_.load(std::memory_order_relaxed) - head_cache_ > mask_;
+      });
+    }
+  }
+
+  // ---- consumer side ----
+  bool try_pop(T& out) {
+    const std::size_t h = head_.load(std::memory_order_relaxed);
+    if (h == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (h == tail_cache_) return false; // empty
+    }
+    out = buf_[h & mask_];
+    publish(head_, h + 1, producer_parked_);
+    return true;
+  }
+
+  // Up to max items in one go, one index update; returns how many
+  std::size_t try_pop_bulk(T* out, std::size_t max) {
+    const std::size_t h = head_.load(std::memory_order_relaxed);
+    if (tail_cache_ - h < max) tail_cache_ = tail_.load(std::memory_order_acquire);
+    std::size_t n = tail_cache_ - h;
+    if (n > max) n = max;
+    for (std::size_t k = 0; k < n; ++k) out[k] = buf_[(h + k) & mask_];
+    if (n) publish(head_, h + n, producer_parked_);
+    return n;
+  }
+
+  void pop(T& out) {
+    for (unsigned n = 0; !try_pop(out); ++n) {
+      wait(n, consumer_parked_, tail_, [&] {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+        return head_.load(std::memory_order_relaxed) == tail_cache_;
+      });
+    }
+  }
+
+private:
+  static constexpr unsigned kSpins  = 64;   // polls before yielding
+  static constexpr unsigned kYields = 64;   // yields before parking (Park only)
+
+  std::unique_ptr<T[]> buf_;
+  std::size_t mask_ = 0;
+
+  alignas(64) std::atomic<std::size_t> head_{0}; // written by the consumer
+  std::size_t tail_cache_ = 0;                   // consumer's view of tail_
+  std::atomic<bool> consumer_parked_{false};
+  alignas(64) std::atomic<std::size_t> tail_{0}; // written by the producer
+  std::size_t head_cache_ = 0;                   // producer's view of head_
+  std::atomic<bool> producer_parked_{false};
+  char pad_[64 - sizeof(std::size_t) - sizeof(std::atomic<bool>)]; // keep neighbours off tail_'s line
+
+  static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  // Store our index; under Park, wake the other side if it is asleep on it
+  static void publish(std::atomic<std::size_t>& idx, std::size_t v, std::atomic<bool>& peer_parked) {
+    idx.store(v, std::memory_order_release);
+    if constexpr (W == WaitStrategy::Park) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (peer_parked.load(std::memory_order_relaxed)) {
+        peer_parked.store(false, std::memory_order_relaxed);
+        idx.notify_one();
+      }
+    }
+  }
+
+  // n-th failed attempt. `still_blocked` re-reads the peer's index.
+  // Park: announce, fence, re-check, then sleep until the index moves.
+  // The fence pairs with the one in publish(): either we see the peer's
+  // new index, or the peer sees our flag and wakes us.
+  template <class Blocked>
+  static void wait(unsigned n, std::atomic<bool>& parked, std::atomic<std::size_t>& peer_idx,
+                   Blocked still_blocked) {
+    if (W == WaitStrategy::Spin || n < kSpins) { cpu_relax(); return; }
+    if (W == WaitStrategy::Yield || n < kSpins + kYields) { std::this_thread::yield(); return; }
+    const std::size_t seen = peer_idx.load(std::memory_order_relaxed);
+    parked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (still_blocked()) peer_idx.wait(seen, std::memory_order_acquire);
+    parked.store(false, std::memory_order_relaxed);
+  }
+};
@@ -0,0 +1,339 @@
+#pragma once
+#include "matching_engine.hpp"
+#include "scheduler.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/*
+Agents: market makers, execution algos and the like, trading in the same
+book as the simulated flow.
+
+An agent never touches the engine. It reacts to notifications by
+appending order intents (limit / market / cancel / replace), and the
+Simulator executes them right away, at the current sim time:
+
+  on_book_update(const AgentUpdate&, Intents&)  once per flow event, after it
+                                                 executed (the whole tape of
+                                                 fills since the last update
+                                                 comes with it, not one call
+                                                 per fill)
+  on_fill(const AgentFill&, Intents&)           one of this agent's own orders
+                                                 traded
+  on_order_ack(const OrderAck&, Intents&)       an intent of this agent was
+                                                 executed: its order id, what
+                                                 rests
+  on_timer(const AgentUpdate&, Intents&)        every timer_interval() sim
+                                                 seconds (0 = no timer)
+
+Dispatch is static. Concrete agents derive from Agent<Self> (CRTP), which
+supplies no-op defaults for the hooks they leave out and the position /
+cash bookkeeping; AgentSet<A, B, ...> keeps one std::vector per agent type
+and loops over each, so a hook call is a direct (usually inlined) call
+and thousands of small agents per book cost no indirection. The
+Simulator sees the set through AgentDriver: one virtual call per
+notification for the whole set, never per agent.
+
+Agents only hear about their own orders through on_fill / on_order_ack,
+and only the simulated flow triggers on_book_update, so agents cannot
+set off a cascade of requotes in response to each other. Fills and acks
+caused by intents are delivered in follow-up rounds (at most
+kMaxAgentRounds per notification); anything left is carried over to the
+next one.
+*/
+
+using AgentId = uint32_t;
+inline constexpr AgentId kNoAgent = UINT32_MAX;
+
+// Order::tag of agents' resting orders: negative, so it never counts as a
+// fill-by-distance bucket
+inline constexpr int8_t kAgentTag = -2;
+
+inline constexpr int kMaxAgentRounds = 4;
+
+struct OrderIntent {
+  enum class Kind : uint8_t { Limit, Market, Cancel, Replace };
+
+  Kind        kind = Kind::Limit;
+  Side        side = Side::Buy;          // Limit / Market
+  TimeInForce tif  = TimeInForce::GTC;   // Limit
+  Price       px   = 0;                  // Limit / Replace
+  Qty         qty  = 0;                  // Limit / Market / Replace
+  OrderId     id   = 0;                  // Cancel / Replace: the agent's resting order
+};
+
+struct QueuedIntent {
+  AgentId     agent;
+  OrderIntent intent;
+};
+using IntentBuffer = std::vector<QueuedIntent>;
+
+// What agents write to: appends intents on behalf of one agent
+class Intents {
+public:
+  Intents(IntentBuffer& buf, AgentId who) : buf_(buf), who_(who) {}
+
+  void limit(Side s, Price px, Qty q, TimeInForce tif = TimeInForce::GTC) {
+    push({OrderIntent::Kind::Limit, s, tif, px, q, 0});
+  }
+  void market(Side s, Qty q) { push({OrderIntent::Kind::Market, s, TimeInForce::IOC, 0, q, 0}); }
+  void cancel(OrderId id)    { push({OrderIntent::Kind::Cancel, Side::Buy, TimeInForce::GTC, 0, 0, id}); }
+  void replace(OrderId id, Price px, Qty q) {
+    push({OrderIntent::Kind::Replace, Side::Buy, TimeInForce::GTC, px, q, id});
+  }
+
+private:
+  void push(const OrderIntent& in) { buf_.push_back({who_, in}); }
+
+  IntentBuffer& buf_;
+  AgentId       who_;
+};
+
+// One fill of an agent's order, from that agent's point of view
+struct AgentFill {
+  Fill    fill;
+  AgentId agent;
+  OrderId id;       // the agent's order (fill.maker_id or fill.taker_id)
+  Side    side;     // the agent's side of the trade
+  bool    maker;    // true: its resting order was hit (always, in a call auction)
+  Qty     leaves;   // maker: what is still resting after this fill (0 = gone)
+
+  OrderId order() const { return id; }
+};
+
+// An executed intent. id: the new order (Limit / Market) or the target
+// (Cancel / Replace). accepted is false for a cancel / replace of an order
+// that is not (or is no longer) this agent's resting order.
+struct OrderAck {
+  AgentId     agent;
+  OrderId     id;
+  OrderIntent intent;
+  Qty         resting;   // qty left in the book under id
+  bool        accepted;
+};
+
+struct AgentUpdate {
+  TimePoint                  t;
+  const OrderBook&           book;
+  Price                      best_bid;   // 0 if the side is empty
+  Price                      best_ask;
+  std::span<const Fill>      tape;       // book updates: every fill since the last one
+  std::span<const AgentFill> own;        // agents' fills to deliver
+  std::span<const OrderAck>  acks;       // executed intents to acknowledge
+  bool                       book_changed; // false: a follow-up / timer round only
+
+  bool  two_sided() const { return best_bid > 0 && best_ask > 0; }
+  Price mid() const       { return (best_bid + best_ask) / 2; }
+};
+
+// Totals over a set of agents; pnl marks positions to `mark`
+struct AgentStats {
+  std::size_t agents  = 0;
+  uint64_t    fills   = 0;
+  uint64_t    volume  = 0;
+  int64_t     position = 0;    // net over the agents
+  double      pnl     = 0.0;
+};
+
+// The Simulator's view of a set of agents
+class AgentDriver {
+public:
+  virtual ~AgentDriver() = default;
+
+  // Before the first event: fixes agent ids, starts timers at t0
+  virtual void start(TimePoint t0) = 0;
+  // Deliver u.own and u.acks, then (if u.book_changed) the book update
+  virtual void notify(const AgentUpdate& u, IntentBuffer& out) = 0;
+  // Timers due at or before u.t
+  virtual void ring(const AgentUpdate& u, IntentBuffer& out) = 0;
+  // Earliest pending timer (EventScheduler::kNever if none)
+  virtual TimePoint next_timer() const = 0;
+  virtual AgentStats stats(Price mark) const = 0;
+};
+
+/*
+CRTP base. Derived hides whichever hooks it implements; AgentSet calls
+through the derived type, so the defaults here inline to nothing.
+*/
+template <class Derived>
+class Agent {
+public:
+  void on_book_update(const AgentUpdate&, Intents&) {}
+  void on_fill(const AgentFill&, Intents&) {}
+  void on_order_ack(const OrderAck&, Intents&) {}
+  void on_timer(const AgentUpdate&, Intents&) {}
+  TimePoint timer_interval() const { return 0.0; }
+
+  int64_t  position() const { return position_; }
+  double   cash()     const { return cash_; }
+  uint64_t fills()    const { return fills_; }
+  uint64_t volume()   const { return volume_; }
+  double   pnl(Price mark) const { return cash_ + double(position_) * double(mark); }
+
+  // AgentSet's entry for fills: books the trade, then Derived::on_fill
+  void deliver(const AgentFill& f, Intents& out) {
+    const int64_t q = f.fill.qty;
+    position_ += f.side == Side::Buy ? q : -q;
+    cash_     += double(f.side == Side::Buy ? -q : q) * double(f.fill.price);
+    ++fills_;
+    volume_   += uint64_t(q);
+    static_cast<Derived&>(*this).on_fill(f, out);
+  }
+
+private:
+  int64_t  position_ = 0;
+  double   cash_     = 0.0;
+  uint64_t fills_    = 0;
+  uint64_t volume_   = 0;
+};
+
+template <class... As>
+class AgentSet final : public AgentDriver {
+public:
+  static_assert(sizeof...(As) > 0, "AgentSet needs at least one agent type");
+
+  // Adds an agent of type A; all adds happen before the run starts
+  template <class A, class... Args>
+  A& add(Args&&... args) {
+    if (started_) throw std::logic_error("AgentSet::add after the run started");
+    return std::get<std::vector<A>>(agents_).emplace_back(std::forward<Args>(args)...);
+  }
+
+  template <class A> std::vector<A>&       of()       { return std::get<std::vector<A>>(agents_); }
+  template <class A> const std::vector<A>& of() const { return std::get<std::vector<A>>(agents_); }
+
+  std::size_t size() const { return std::apply([](const auto&... v) { return (v.size() + ...); }, agents_); }
+
+  void start(TimePoint t0) override {
+    started_ = true;
+    AgentId next = 0;
+    std::size_t k = 0;
+    ((offset_[k++] = next, next += AgentId(of<As>().size())), ...);
+    timers_.resize(next);
+    for_each([&](AgentId id, auto& a) {
+      const TimePoint dt = a.timer_interval();
+      if (dt > 0.0) timers_.schedule(id, t0 + dt);
+    });
+  }
+
+  void notify(const AgentUpdate& u, IntentBuffer& out) override {
+    for (const AgentFill& f : u.own) visit(f.agent, [&](auto& a) { Intents in(out, f.agent); a.deliver(f, in); });
+    for (const OrderAck& k : u.acks) visit(k.agent, [&](auto& a) { Intents in(out, k.agent); a.on_order_ack(k, in); });
+    if (!u.book_changed) return;
+    for_each([&](AgentId id, auto& a) { Intents in(out, id); a.on_book_update(u, in); });
+  }
+
+  void ring(const AgentUpdate& u, IntentBuffer& out) override {
+    while (!timers_.empty() && timers_.top_time() <= u.t) {
+      const AgentId id = timers_.top();
+      const TimePoint due = timers_.top_time();
+      visit(id, [&](auto& a) {
+        Intents in(out, id);
+        a.on_timer(u, in);
+        timers_.schedule(id, due + a.timer_interval());
+      });
+    }
+  }
+
+  TimePoint next_timer() const override {
+    return timers_.empty() ? EventScheduler::kNever : timers_.top_time();
+  }
+
+  AgentStats stats(Price mark) const override {
+    AgentStats s;
+    for_each(*this, [&](AgentId, const auto& a) {
+      ++s.agents;
+      s.fills    += a.fills();
+      s.volume   += a.volume();
+      s.position += a.position();
+      s.pnl      += a.pnl(mark);
+    });
+    return s;
+  }
+
+private:
+  // f(id, agent) over every agent, type by type
+  template <class F> void for_each(F&& f) { for_each(*this, f); }
+
+  template <class Self, class F>
+  static void for_each(Self& self, F&& f) {
+    std::size_t k = 0;
+    ([&] {
+      auto& v = self.template of<As>();
+      const AgentId base = self.offset_[k++];
+      for (std::size_t i = 0; i < v.size(); ++i) f(AgentId(base + i), v[i]);
+    }(), ...);
+  }
+
+  // f(agent) for the agent with this id
+  template <class F>
+  void visit(AgentId id, F&& f) {
+    std::size_t k = 0;
+    bool done = false;
+    ([&] {
+      auto& v = of<As>();
+      const AgentId base = offset_[k++];
+      if (!done && id >= base && id - base < v.size()) { f(v[id - base]); done = true; }
+    }(), ...);
+  }
+
+  std::tuple<std::vector<As>...>        agents_;
+  std::array<AgentId, sizeof...(As)>    offset_{};
+  EventScheduler                        timers_;   // one clock per agent id
+  bool                                  started_ = false;
+};
+
+// ---- shipped agents ----
+
+/*
+Quotes one bid and one ask `half_spread` ticks either side of mid, `size`
+each, and moves them (replace, keeping the order id) once mid has moved
+`requote` ticks away from where they were priced. Stops quoting the side
+that would take |position| past max_position.
+*/
+class QuotingMaker : public Agent<QuotingMaker> {
+public:
+  QuotingMaker(Qty size, Price half_spread, Price requote, int64_t max_position);
+
+  void on_book_update(const AgentUpdate& u, Intents& out);
+  void on_fill(const AgentFill& f, Intents& out);
+  void on_order_ack(const OrderAck& k, Intents& out);
+
+private:
+  struct Quote {
+    OrderId id = 0;          // resting order (0 = none)
+    Price   px = 0;
+    bool    pending = false; // intent sent, ack not back yet
+  };
+  void quote(Side s, Quote& q, Price target, bool allowed, Intents& out);
+
+  Qty     size_;
+  Price   half_spread_;
+  Price   requote_;
+  int64_t max_position_;
+  Quote   bid_, ask_;
+};
+
+// Works a parent order of `total` on side `side` in market-order slices of
+// `slice`, one slice every `interval` sim seconds
+class TwapExecutor : public Agent<TwapExecutor> {
+public:
+  TwapExecutor(Side side, Qty total, Qty slice, TimePoint interval);
+
+  void      on_timer(const AgentUpdate& u, Intents& out);
+  TimePoint timer_interval() const { return interval_; }
+
+  Qty sent() const { return sent_; }
+
+private:
+  Side      side_;
+  Qty       total_;
+  Qty       slice_;
+  TimePoint interval_;
+  Qty       sent_ = 0;
+};
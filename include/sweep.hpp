@@ -0,0 +1,56 @@
+#pragma once
+#include "checkpoint.hpp"
+#include "metrics.hpp"
+#include "sim_config.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/*
+Multi-run sweeps: a grid of configs, each run under a list of seeds.
+
+Every (point, seed) pair is an independent job: it builds its own
+Simulator from a copy of the config, runs it silently and writes its
+SimStats into its own slot of a pre-sized result vector. Workers share
+nothing mutable but the job ranges below, so throughput scales with
+cores, and results come out in grid order whatever the thread count.
+The reduction into means and confidence intervals happens after join.
+*/
+
+// Run f(0) .. f(n-1) on `threads` workers (0 = hardware concurrency).
+// Each worker starts on a contiguous slice of [0, n); when its slice runs
+// out it steals the back half of another worker's remaining slice. If an
+// f throws, the workers stop taking jobs and the first exception (lowest
+// worker) is rethrown here once all have joined.
+void parallel_for_stealing(std::size_t n, unsigned threads,
+                           const std::function<void(std::size_t)>& f);
+
+// Base config of the M3 parameter sweeps (and of the benchmarks' end-to-end runs)
+SimConfig m3_sweep_base(BookBackend backend = BookBackend::Map, RngKind rng = RngKind::Xoshiro);
+
+// One independent run per config, in parallel; results[i] belongs to cfgs[i].
+// With `warm`, every run forks from that checkpoint (Resume::Fork) instead
+// of starting from an empty book; the checkpoint is only read.
+std::vector<SimStats> run_many(const std::vector<SimConfig>& cfgs, unsigned threads = 0,
+                               const Checkpoint* warm = nullptr);
+
+struct SweepPoint {
+  std::string label;
+  SimConfig   cfg;     // seed is overwritten per run
+};
+
+struct SweepResult {
+  std::string           label;
+  std::vector<SimStats> runs;     // one per seed, in seed order
+  StatsSummary          summary;  // across seeds
+};
+
+std::vector<SweepResult> run_sweep(const std::vector<SweepPoint>& grid,
+                                   const std::vector<uint64_t>& seeds,
+                                   unsigned threads = 0,
+                                   const Checkpoint* warm = nullptr);
+
+void print_sweep(std::ostream& os, const std::vector<SweepResult>& results);
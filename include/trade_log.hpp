@@ -0,0 +1,76 @@
+#pragma once
+#include "event_log.hpp"   // FillRecord, LogHeader
+#include "sim_config.hpp"  // TradeLogFormat, Backpressure
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Asynchronous trade log.
+
+The hot thread only packs each Fill into a 40-byte FillRecord and pushes
+it into a preallocated SPSC ring. A background writer drains the ring in
+large chunks and does everything slow: formatting (Text), buffering and
+write(2). When the ring is full the policy decides:
+  - Block: the producer waits for the writer (nothing is lost),
+  - Drop:  the record is discarded and counted in dropped().
+
+Text gives the same "TRADE t=... taker=..." lines execute() used to
+print, Binary gives a .fills-style file (LogHeader + FillRecords) that
+FillLogReader can map. Text on stdout is written from the writer thread,
+so trade lines no longer interleave exactly with other console output.
+
+If writing fails, the writer keeps draining (so a blocked producer never
+hangs) and close() rethrows the error.
+*/
+class TradeLogger {
+public:
+  TradeLogger(const std::string& path, TradeLogFormat fmt, Backpressure bp,
+              std::size_t ring_capacity = 1 << 16);
+  ~TradeLogger();   // close(), errors swallowed
+
+  TradeLogger(const TradeLogger&) = delete;
+  TradeLogger& operator=(const TradeLogger&) = delete;
+
+  // hot path
+  void log(const Fill& f) {
+    const FillRecord r = FillRecord::from(f);
+    if (bp_ == Backpressure::Block) ring_.push(r);
+    else if (!ring_.try_push(r)) dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Drain everything still queued, stop the writer, close the file
+  void close();
+
+  uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr std::size_t kChunk = 4096;   // records per drain
+
+  SpscRing<FillRecord, WaitStrategy::Yield> ring_;
+  TradeLogFormat fmt_;
+  Backpressure   bp_;
+  std::string    path_;
+  int            fd_ = -1;
+  bool           own_fd_ = false;
+
+  std::atomic<bool>     stop_{false};
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::exception_ptr    error_;
+  std::thread           writer_;
+  bool                  closed_ = false;
+
+  std::vector<char> out_;   // writer-side output buffer
+  std::size_t       used_ = 0;
+
+  void run();                                     // writer thread body
+  void emit(const FillRecord* r, std::size_t n);  // format into out_
+  void flush();
+};
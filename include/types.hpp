@@ -11,7 +11,19 @@ using Price = int64_t;    // ticks
 using Qty   = int64_t;    // units
 using OrderId = uint64_t;
 using TimePoint = double; // simulation time in seconds (decimals)
+using SymbolId = uint32_t; // instrument in a multi-symbol run
+
+// Stable handle to a pooled order node (index into the pool, never moves)
+using OrderHandle = uint32_t;
+inline constexpr OrderHandle kNullHandle = UINT32_MAX;
 
 // like choosing from a menu
 enum class Side : uint8_t { Buy, Sell };
-enum class OrdType : uint8_t { Limit, Market, Cancel };
\ No newline at end of file
+enum class OrdType : uint8_t { Limit, Market, Cancel };
+
+// How long the unfilled part of a limit order lives
+enum class TimeInForce : uint8_t {
+  GTC,  // rests in the book (plain limit)
+  IOC,  // immediate-or-cancel: trade what crosses now, drop the rest
+  FOK   // fill-or-kill: all of it now, or nothing at all
+};
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "auction.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+OrderId CallAuction::limit(Side s, Price px, Qty q, TimePoint t, int8_t tag) {
+  if (q <= 0) throw std::invalid_argument("limit qty must be > 0");
+  if (px <= 0) throw std::invalid_argument("limit price must be > 0");
+  const OrderId id = me_.assign_id();
+  calls_.push_back({id, px, q, t, s, tag});
+  return id;
+}
+
+OrderId CallAuction::market(Side s, Qty q, TimePoint t) {
+  if (q <= 0) throw std::invalid_argument("market qty must be > 0");
+  const OrderId id = me_.assign_id();
+  calls_.push_back({id, 0, q, t, s, -1});
+  return id;
+}
+
+// calls_ is in id order: a binary search
+CallOrder* CallAuction::find(OrderId id) {
+  auto it = std::lower_bound(calls_.begin(), calls_.end(), id,
+                             [](const CallOrder& c, OrderId k) { return c.id < k; });
+  return it != calls_.end() && it->id == id && it->qty > 0 ? &*it : nullptr;
+}
+
+bool CallAuction::cancel(OrderId id) {
+  CallOrder* c = find(id);
+  if (!c) return false;
+  c->qty = 0;
+  return true;
+}
+
+AuctionResult CallAuction::indicative(Price ref) const {
+  if (calls_.empty()) return {};   // the book alone never crosses
+  return discover(ref);
+}
+
+/*
+One counting sort over both sides when the limits' prices are close
+together (the usual case: a batch of flow around mid), a stable sort
+otherwise; arrival order is kept within a price either way. The bucket
+is plain arithmetic on side and price, with no branch on either: the
+sides of a batch of flow come in no particular order, and a branch on
+them would mispredict about every other order, every pass.
+
+Buckets: the buys' markets, one per tick from the best buy price down,
+the sells' markets, one per tick from the best sell price up, then the
+cancelled orders.
+*/
+void CallAuction::sort_calls() const {
+  constexpr Price kNone = std::numeric_limits<Price>::max();
+  const uint32_t n = uint32_t(calls_.size());
+  Price lo[2] = {kNone, kNone}, hi[2] = {0, 0};
+  uint32_t live[2] = {0, 0};
+  for (const CallOrder& c : calls_) {
+    const int si = int(c.side);
+    lo[si] = std::min(lo[si], c.px ? c.px : kNone);
+    hi[si] = std::max(hi[si], c.px);
+    live[si] += c.qty > 0;
+  }
+  side_end_[0] = live[0];
+  side_end_[1] = live[0] + live[1];
+  sorted_.resize(n);
+
+  uint64_t span[2];
+  for (int si = 0; si < 2; ++si) span[si] = lo[si] == kNone ? 0 : uint64_t(hi[si] - lo[si]) + 1;
+  if (span[0] + span[1] > 4 * uint64_t(n) + 64) {
+    for (uint32_t k = 0; k < n; ++k) sorted_[k] = k;
+    auto key = [&](uint32_t k) {
+      const CallOrder& c = calls_[k];
+      return std::tuple(c.qty == 0, int(c.side), c.px != 0, c.side == Side::Buy ? -c.px : c.px);
+    };
+    std::stable_sort(sorted_.begin(), sorted_.end(), [&](uint32_t a, uint32_t b) { return key(a) < key(b); });
+    return;
+  }
+
+  const std::size_t sells = 1 + std::size_t(span[0]);
+  const std::size_t dead  = sells + 1 + std::size_t(span[1]);
+  auto bucket = [&](const CallOrder& c) {
+    const bool sell = c.side == Side::Sell;
+    const std::size_t off = c.px == 0 ? 0 : 1 + std::size_t(sell ? c.px - lo[1] : hi[0] - c.px);
+    return c.qty > 0 ? (sell ? sells : 0) + off : dead;
+  };
+  count_.assign(dead + 2, 0);
+  for (const CallOrder& c : calls_) ++count_[bucket(c) + 1];
+  for (std::size_t b = 1; b < count_.size(); ++b) count_[b] += count_[b - 1];
+  for (uint32_t k = 0; k < n; ++k) sorted_[count_[bucket(calls_[k])]++] = k;
+}
+
+/*
+The curves only go as deep as anything can trade. A bid meets limit asks
+only at or above the best ask (book or collected), and market sells at
+any price, best bids first; so the book's bid levels needed are those at
+or above the best ask plus, below it, enough to cover the market sells.
+Same for the asks. Collected orders are all in the curve already.
+*/
+AuctionResult CallAuction::discover(Price ref) const {
+  sort_calls();
+
+  Qty   mkt[2]  = {0, 0};
+  Price best[2] = {0, 0};     // best limit price per side, book or collected (0: none)
+  uint32_t markets[2] = {0, 0};   // past the side's markets in sorted_
+  for (int si = 0; si < 2; ++si) {
+    uint32_t k = si ? side_end_[0] : 0;
+    for (; k < side_end_[si] && calls_[sorted_[k]].px == 0; ++k) mkt[si] += calls_[sorted_[k]].qty;
+    markets[si] = k;
+    if (k < side_end_[si]) best[si] = calls_[sorted_[k]].px;
+  }
+  if (!book_.bids.empty()) best[0] = std::max(best[0], book_.best_bid());
+  if (!book_.asks.empty()) best[1] = best[1] ? std::min(best[1], book_.best_ask()) : book_.best_ask();
+
+  for (Side s : {Side::Buy, Side::Sell}) {
+    const int si = int(s), oi = 1 - si;
+    const bool buy = s == Side::Buy;
+    std::vector<Level>& curve = curve_[si];
+    curve.clear();
+    if (mkt[si]) curve.push_back({0, mkt[si], 0, 0, si ? side_end_[0] : 0, markets[si]});
+
+    // the book's levels that can trade, best-first
+    book_levels_.clear();
+    Qty cum = 0;
+    auto needed = [&](Price px, const LevelQueue& q) {
+      const bool crosses = best[oi] && (buy ? px >= best[oi] : px <= best[oi]);
+      if (!crosses && cum >= mkt[oi]) return false;
+      book_levels_.push_back({px, q.total_qty, uint32_t(q.count)});
+      cum += q.total_qty;
+      return true;
+    };
+    if (buy) book_.bids.for_each_level(needed);
+    else     book_.asks.for_each_level(needed);
+
+    // merged with the collected limits' price runs, best-first
+    const uint32_t end = side_end_[si];
+    std::size_t b = 0;
+    uint32_t k = markets[si];
+    auto better = [&](Price a, Price c) { return buy ? a > c : a < c; };
+    while (b < book_levels_.size() || k < end) {
+      const Price bp = b < book_levels_.size() ? book_levels_[b].px : 0;
+      const Price cp = k < end ? calls_[sorted_[k]].px : 0;
+      Level lv{0, 0, 0, 0, k, k};
+      lv.px = !cp || (bp && !better(cp, bp)) ? bp : cp;
+      if (bp == lv.px) { lv.book_qty = book_levels_[b].qty; lv.qty = lv.book_qty; ++b; }
+      for (; k < end && calls_[sorted_[k]].px == lv.px; ++k) lv.qty += calls_[sorted_[k]].qty;
+      lv.last = k;
+      curve.push_back(lv);
+    }
+  }
+
+  // Pair the curves level by level while they cross (a market segment,
+  // px 0, crosses anything). bid_px / ask_px end up as the last limit
+  // levels used: the lowest bid and the highest ask that trade.
+  const std::vector<Level>& bids = curve_[int(Side::Buy)];
+  const std::vector<Level>& asks = curve_[int(Side::Sell)];
+  Qty volume = 0;
+  Price bid_px = 0, ask_px = 0;
+  std::size_t i = 0, j = 0;
+  Qty bl = bids.empty() ? 0 : bids[0].qty;
+  Qty al = asks.empty() ? 0 : asks[0].qty;
+  while (i < bids.size() && j < asks.size()) {
+    const Price b = bids[i].px, a = asks[j].px;
+    if (b && a && b < a) break;
+    const Qty x = std::min(bl, al);
+    volume += x;
+    if (b) bid_px = b;
+    if (a) ask_px = a;
+    bl -= x;
+    al -= x;
+    if (bl == 0 && ++i < bids.size()) bl = bids[i].qty;
+    if (al == 0 && ++j < asks.size()) al = asks[j].qty;
+  }
+
+  AuctionResult r;
+  if (!bid_px && !ask_px) return r;   // nothing, or market orders alone: no price
+  const Price lo = ask_px ? ask_px : bid_px;
+  const Price hi = bid_px ? bid_px : ask_px;
+  r.price  = ref ? std::clamp(ref, lo, hi) : lo + (hi - lo) / 2;
+  r.volume = volume;
+  return r;
+}
+
+/*
+Price priority first: the curve's levels are taken in order, each in
+full while the volume lasts. The level where it runs out is shared
+between its orders by allocation() (share), the book's queue ahead of
+the collected orders.
+*/
+void CallAuction::allocate(Side s, Qty volume) {
+  std::vector<Take>& out = takes_[int(s)];
+  out.clear();
+  auto orders_of = [&](const Level& lv, std::vector<Take>& dst) {
+    if (lv.book_qty) {
+      // nodes stay put until settle, so the pointers hold
+      LevelQueue* q = s == Side::Buy ? book_.bids.find(lv.px) : book_.asks.find(lv.px);
+      book_.for_each(*q, [&](RestingOrder& o) { dst.push_back({o.id, o.qty, &o.qty, &o.tag, true}); });
+    }
+    for (uint32_t k = lv.first; k < lv.last; ++k) {
+      CallOrder& c = calls_[sorted_[k]];
+      dst.push_back({c.id, c.qty, &c.qty, &c.tag, false});
+    }
+  };
+
+  Qty left = volume;
+  for (Level& lv : curve_[int(s)]) {
+    lv.book_taken = 0;
+    if (left == 0) continue;
+    if (lv.qty <= left) {
+      orders_of(lv, out);
+      lv.book_taken = lv.book_qty;
+      left -= lv.qty;
+    } else {
+      const std::size_t first = out.size();
+      level_.clear();
+      orders_of(lv, level_);
+      share(level_, lv.qty, left, out);
+      for (std::size_t k = first; k < out.size(); ++k)
+        if (out[k].resting) lv.book_taken += out[k].qty;
+      left = 0;
+    }
+  }
+}
+
+// `want` (< level_qty) out of one level's orders, in time priority
+void CallAuction::share(std::vector<Take>& level, Qty level_qty, Qty want,
+                        std::vector<Take>& out) const {
+  if (alloc_ == Allocation::TimePriority) {
+    for (Take& o : level) {
+      if (want == 0) break;
+      o.qty = std::min(o.qty, want);
+      out.push_back(o);
+      want -= o.qty;
+    }
+    return;
+  }
+
+  // Pro rata: floor(qty * want / level_qty) each (128-bit product, no
+  // overflow), then the units lost to rounding one each, front to back
+  // (every share is below its order's qty, so one pass places them)
+  Qty given = 0;
+  for (Take& o : level) {
+    const Qty x = Qty((__int128)o.qty * want / level_qty);
+    given += x;
+    o.qty = x;
+  }
+  for (std::size_t k = 0; given < want; ++k, ++given) ++level[k].qty;
+  // orders whose share rounded to nothing do not trade
+  for (const Take& o : level)
+    if (o.qty > 0) out.push_back(o);
+}
+
+void CallAuction::settle(Side s) {
+  const bool front_only = alloc_ == Allocation::TimePriority;
+  for (const Level& lv : curve_[int(s)])
+    if (lv.book_taken) book_.settle(s, lv.px, lv.book_taken, front_only);
+}
+
+// What the collected limits have left rests behind the book's own orders
+// at each price, in arrival order. Going by sorted_ adds a level's orders
+// one after the other, and the traded ones (at 0) come in one run.
+void CallAuction::rest_remainder() {
+  for (uint32_t k = 0; k < side_end_[1]; ++k) {
+    const CallOrder& c = calls_[sorted_[k]];
+    if (c.px && c.qty > 0) book_.add_limit(Order{ c.id, c.side, OrdType::Limit, c.px, c.qty, c.ts, c.tag });
+  }
+  calls_.clear();
+}
+
+AuctionResult CallAuction::uncross(TimePoint t, std::vector<Fill>& out, Price ref) {
+  return uncross(t, [&](const Fill& f) { out.push_back(f); }, ref);
+}
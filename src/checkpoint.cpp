@@ -0,0 +1,88 @@
+#include "checkpoint.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::size_t kFixed = sizeof(LogHeader) + sizeof(CheckpointHeader);
+
+std::size_t image_size(uint64_t orders) {
+  return kFixed + std::size_t(orders) * (sizeof(RestingRecord) + sizeof(OrderId));
+}
+
+} // namespace
+
+void Checkpoint::point_into(const uint8_t* p) {
+  header_  = reinterpret_cast<const CheckpointHeader*>(p + sizeof(LogHeader));
+  orders_  = reinterpret_cast<const RestingRecord*>(p + kFixed);
+  resting_ = reinterpret_cast<const OrderId*>(p + kFixed + header_->orders * sizeof(RestingRecord));
+}
+
+Checkpoint::Checkpoint(const CheckpointHeader& h, const OrderBook& ob, const MatchingEngine& me) {
+  const std::size_t n = ob.resting();
+  bytes_.assign(image_size(n), 0);
+
+  const LogHeader lh = LogHeader::make(kCheckpointMagic, sizeof(RestingRecord));
+  std::memcpy(bytes_.data(), &lh, sizeof lh);
+  CheckpointHeader ch = h;
+  ch.next_id = me.next_order_id();
+  ch.orders  = n;
+  std::memcpy(bytes_.data() + sizeof lh, &ch, sizeof ch);
+  point_into(bytes_.data());
+
+  // levels in book order, each in time priority: re-adding them in this
+  // order rebuilds every queue as it was
+  RestingRecord* r = reinterpret_cast<RestingRecord*>(bytes_.data() + kFixed);
+  auto level = [&](Price, const LevelQueue& q) {
+    ob.for_each(q, [&](const RestingOrder& o) {
+      *r = RestingRecord{};
+      r->id   = o.id;
+      r->px   = o.limit_price;
+      r->qty  = o.qty;
+      r->ts   = o.ts;
+      r->side = o.side;
+      ++r;
+    });
+  };
+  ob.bids.for_each_level(level);
+  ob.asks.for_each_level(level);
+
+  OrderId* ids = reinterpret_cast<OrderId*>(r);
+  for (std::size_t k = 0; k < n; ++k) ids[k] = ob.resting_at(k);
+}
+
+Checkpoint::Checkpoint(const std::string& path)
+  : file_(std::make_unique<MappedFile>(path, /*sequential=*/false)) {
+  if (file_->size() < kFixed) throw std::runtime_error("not a checkpoint: " + path);
+
+  LogHeader h;
+  std::memcpy(&h, file_->data(), sizeof h);
+  if (std::memcmp(h.magic, kCheckpointMagic, sizeof h.magic) != 0) throw std::runtime_error("wrong magic in " + path);
+  if (h.byte_order != LogHeader::kByteOrder)       throw std::runtime_error("foreign byte order in " + path);
+  if (h.version != LogHeader::kVersion)            throw std::runtime_error("unsupported version in " + path);
+  if (h.record_size != sizeof(RestingRecord))      throw std::runtime_error("record size mismatch in " + path);
+
+  point_into(file_->data());
+  if (file_->size() != image_size(header_->orders)) throw std::runtime_error("truncated checkpoint " + path);
+}
+
+void Checkpoint::save(const std::string& path) const {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(header_) - sizeof(LogHeader);
+  const std::size_t n = image_size(header_->orders);
+
+  std::FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) throw std::runtime_error("cannot create " + path + ": " + std::strerror(errno));
+  const bool ok = std::fwrite(p, 1, n, f) == n;
+  if (std::fclose(f) != 0 || !ok) throw std::runtime_error("write failed on " + path);
+}
+
+void Checkpoint::restore(OrderBook& ob, MatchingEngine& me) const {
+  if (ob.resting() != 0) throw std::logic_error("Checkpoint::restore needs an empty book");
+  ob.reserve(std::size_t(header_->orders));
+  for (const RestingRecord& r : orders())
+    ob.add_limit(Order{r.id, r.side, OrdType::Limit, r.px, r.qty, r.ts});
+  ob.reorder_resting(resting_, std::size_t(header_->orders));
+  me.resume_ids(header_->next_id);
+}
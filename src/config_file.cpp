@@ -0,0 +1,248 @@
+#include "config_file.hpp"
+#include <charconv>
+#include <fstream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+// ---- values: parse (false if v is not one) and format, per field type ----
+
+template <class T>
+  requires (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+bool parse(std::string_view v, T& out) {
+  T x{};
+  const auto [end, ec] = std::from_chars(v.data(), v.data() + v.size(), x);
+  if (ec != std::errc{} || end != v.data() + v.size()) return false;
+  out = x;
+  return true;
+}
+
+bool parse(std::string_view v, bool& out) {
+  if (v == "true")  { out = true;  return true; }
+  if (v == "false") { out = false; return true; }
+  return false;
+}
+
+bool parse(std::string_view v, std::string& out) {
+  out = v;
+  return true;
+}
+
+template <class E> using Names = std::span<const std::pair<std::string_view, E>>;
+
+constexpr std::pair<std::string_view, BookBackend> kBackends[] = {
+  {"map", BookBackend::Map}, {"ladder", BookBackend::Ladder}};
+constexpr std::pair<std::string_view, RngKind> kRngs[] = {
+  {"xoshiro", RngKind::Xoshiro}, {"philox", RngKind::Philox}};
+constexpr std::pair<std::string_view, WaitStrategy> kWaits[] = {
+  {"spin", WaitStrategy::Spin}, {"yield", WaitStrategy::Yield}, {"park", WaitStrategy::Park}};
+constexpr std::pair<std::string_view, TradeLogFormat> kFormats[] = {
+  {"text", TradeLogFormat::Text}, {"binary", TradeLogFormat::Binary}};
+constexpr std::pair<std::string_view, Backpressure> kPolicies[] = {
+  {"block", Backpressure::Block}, {"drop", Backpressure::Drop}};
+constexpr std::pair<std::string_view, Allocation> kAllocations[] = {
+  {"time", Allocation::TimePriority}, {"pro-rata", Allocation::ProRata}};
+
+Names<BookBackend>    names(BookBackend)    { return kBackends; }
+Names<RngKind>        names(RngKind)        { return kRngs; }
+Names<WaitStrategy>   names(WaitStrategy)   { return kWaits; }
+Names<TradeLogFormat> names(TradeLogFormat) { return kFormats; }
+Names<Backpressure>   names(Backpressure)   { return kPolicies; }
+Names<Allocation>     names(Allocation)     { return kAllocations; }
+
+template <class E>
+  requires std::is_enum_v<E>
+bool parse(std::string_view v, E& out) {
+  for (const auto& [name, e] : names(E{}))
+    if (name == v) { out = e; return true; }
+  return false;
+}
+
+template <class T>
+  requires std::is_arithmetic_v<T>
+std::string format(T x) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return x ? "true" : "false";
+  } else {
+    char buf[32];
+    const auto [end, ec] = std::to_chars(buf, buf + sizeof buf, x);  // shortest round-trip for doubles
+    return std::string(buf, end);
+  }
+}
+
+std::string format(const std::string& s) { return s; }
+
+template <class E>
+  requires std::is_enum_v<E>
+std::string format(E e) {
+  for (const auto& [name, x] : names(E{}))
+    if (x == e) return std::string(name);
+  return std::to_string(int(e));
+}
+
+// ---- the keys ----
+
+// What a numeric field may hold, on top of parsing as its type
+enum class Range : uint8_t {
+  Any,
+  Unit,      // a probability, [0, 1]
+  UnitPos,   // (0, 1]
+  Positive,  // > 0 (sizes, counts, rates)
+  NonNeg,    // >= 0 (0 = off)
+};
+
+template <class T>
+bool in_range(const T& x, Range r) {
+  if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+    switch (r) {
+      case Range::Any:      return true;
+      case Range::Unit:     return x >= T(0) && x <= T(1);
+      case Range::UnitPos:  return x >  T(0) && x <= T(1);
+      case Range::Positive: return x >  T(0);
+      case Range::NonNeg:   return x >= T(0);
+    }
+    return false;
+  } else {
+    return r == Range::Any;
+  }
+}
+
+const char* describe(Range r) {
+  switch (r) {
+    case Range::Unit:     return " (must be in [0, 1])";
+    case Range::UnitPos:  return " (must be in (0, 1])";
+    case Range::Positive: return " (must be > 0)";
+    case Range::NonNeg:   return " (must be >= 0)";
+    default:              return "";
+  }
+}
+
+struct Field {
+  std::string_view key;
+  Range       range;
+  bool        (*set)(SimConfig&, std::string_view, Range);  // false: no parse or out of range
+  std::string (*get)(const SimConfig&);
+};
+
+// Get: a captureless generic lambda returning the member for a SimConfig
+// (const or not), so one accessor serves both directions. A value is
+// parsed and range-checked aside, so a rejected one leaves the field as it was.
+template <class Get>
+constexpr Field field(std::string_view key, Range range, Get) {
+  return { key, range,
+           [](SimConfig& c, std::string_view v, Range r) {
+             auto x = Get{}(c);
+             if (!parse(v, x) || !in_range(x, r)) return false;
+             Get{}(c) = std::move(x);
+             return true;
+           },
+           [](const SimConfig& c) { return format(Get{}(c)); } };
+}
+
+#define LOB_KEY(member, range) field(#member, Range::range, [](auto& c) -> auto& { return c.member; })
+
+const Field kFields[] = {
+  LOB_KEY(seed, Any),
+  LOB_KEY(max_events, Positive),
+  LOB_KEY(rng, Any),
+  LOB_KEY(stream, Any),
+  LOB_KEY(gen_batch, Positive),
+  LOB_KEY(latency_sample, Positive),
+  LOB_KEY(metrics_window, NonNeg),
+  LOB_KEY(snapshot_every, NonNeg),
+  LOB_KEY(snapshot_path, Any),
+  LOB_KEY(snapshot_depth, Positive),
+  LOB_KEY(snapshot_full_every, Positive),
+  LOB_KEY(pipeline, Any),
+  LOB_KEY(pipeline_wait, Any),
+  LOB_KEY(pipeline_ring, Positive),
+
+  LOB_KEY(regime.p_LL, Unit),
+  LOB_KEY(regime.p_HH, Unit),
+  LOB_KEY(regime.low.lambda, Positive),
+  LOB_KEY(regime.low.mix.p_limit_buy, Unit),
+  LOB_KEY(regime.low.mix.p_limit_sell, Unit),
+  LOB_KEY(regime.low.mix.p_mkt_buy, Unit),
+  LOB_KEY(regime.low.mix.p_mkt_sell, Unit),
+  LOB_KEY(regime.high.lambda, Positive),
+  LOB_KEY(regime.high.mix.p_limit_buy, Unit),
+  LOB_KEY(regime.high.mix.p_limit_sell, Unit),
+  LOB_KEY(regime.high.mix.p_mkt_buy, Unit),
+  LOB_KEY(regime.high.mix.p_mkt_sell, Unit),
+
+  LOB_KEY(mean_limit_qty, Positive),
+  LOB_KEY(mean_market_qty, Positive),
+  LOB_KEY(initial_mid_ticks, Positive),
+  LOB_KEY(min_price_ticks, Positive),
+  LOB_KEY(max_offset_ticks, NonNeg),
+  LOB_KEY(geolap_alpha, UnitPos),
+  LOB_KEY(keep_cross_prob, Unit),
+
+  LOB_KEY(book_backend, Any),
+  LOB_KEY(max_resting, NonNeg),
+  LOB_KEY(max_depth_ticks, NonNeg),
+  LOB_KEY(auction_interval, NonNeg),
+  LOB_KEY(auction_allocation, Any),
+
+  LOB_KEY(log_trades, Any),
+  LOB_KEY(trade_log, Any),
+  LOB_KEY(trade_log_format, Any),
+  LOB_KEY(trade_log_policy, Any),
+  LOB_KEY(event_log, Any),
+  LOB_KEY(event_log_fills, Any),
+};
+
+#undef LOB_KEY
+
+std::string_view trim(std::string_view s) {
+  const auto b = s.find_first_not_of(" \t\r");
+  if (b == std::string_view::npos) return {};
+  return s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+}
+
+} // namespace
+
+void set_config(SimConfig& c, std::string_view key, std::string_view value) {
+  key = trim(key);
+  value = trim(value);
+  for (const Field& f : kFields) {
+    if (f.key != key) continue;
+    if (!f.set(c, value, f.range))
+      throw std::invalid_argument("bad value for " + std::string(key) + ": '" + std::string(value) + "'" +
+                                  describe(f.range));
+    return;
+  }
+  throw std::invalid_argument("unknown config key: " + std::string(key));
+}
+
+void set_config(SimConfig& c, std::string_view assignment) {
+  const auto eq = assignment.find('=');
+  if (eq == std::string_view::npos)
+    throw std::invalid_argument("expected key=value: '" + std::string(assignment) + "'");
+  set_config(c, assignment.substr(0, eq), assignment.substr(eq + 1));
+}
+
+void load_config(SimConfig& c, const std::string& path) {
+  std::ifstream in(path);
+  if (!in) throw std::runtime_error("cannot open " + path);
+  std::string line;
+  for (std::size_t n = 1; std::getline(in, line); ++n) {
+    std::string_view s = line;
+    s = trim(s.substr(0, s.find('#')));
+    if (s.empty()) continue;
+    try {
+      set_config(c, s);
+    } catch (const std::invalid_argument& e) {
+      throw std::invalid_argument(path + ":" + std::to_string(n) + ": " + e.what());
+    }
+  }
+  if (in.bad()) throw std::runtime_error("read failed on " + path);
+}
+
+void write_config(std::ostream& os, const SimConfig& c) {
+  for (const Field& f : kFields) os << f.key << " = " << f.get(c) << "\n";
+}
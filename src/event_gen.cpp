@@ -0,0 +1,257 @@
+#include "event_gen.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+void EventBatch::resize(std::size_t rows) {
+  ts_ns.resize(rows);
+  regime.resize(rows);
+  type.resize(rows);
+  side.resize(rows);
+  qty.resize(rows);
+  offset.resize(rows);
+  pick.resize(rows);
+}
+
+// log(1 - p) for a geometric with success prob p (clamped into (0, 1])
+static double log_fail(double p) {
+  if (!(p > 0.0)) p = 1.0;
+  if (p >= 1.0) return -std::numeric_limits<double>::infinity();
+  return std::log1p(-p);
+}
+
+// Shifted geometric on {1, 2, ...} by inversion: 1 + floor(log(U) / log(1-p))
+static int64_t geometric1(uint64_t r, double log_q) {
+  const double U = 1.0 - to_unit(r);         // (0, 1]
+  const double k = std::floor(std::log(U) / log_q);
+  return 1 + (k < 1e12 ? int64_t(k) : int64_t(1e12));
+}
+
+EventGenerator::EventGenerator(const SimConfig& cfg)
+  : kind_(cfg.rng), rng_(cfg.seed), key_(cfg.seed), stream_(cfg.stream) {
+  const double p_stay[2] = { cfg.regime.p_LL, cfg.regime.p_HH };
+  const RegimeParams* params[2] = { &cfg.regime.low, &cfg.regime.high };
+  for (int r = 0; r < 2; ++r) {
+    const double lambda = params[r]->lambda;
+    if (!(lambda > 0.0)) throw std::invalid_argument("EventGenerator: regime lambda must be > 0");
+    const RegimeMix& m = params[r]->mix;
+    if (m.p_limit_buy + m.p_limit_sell + m.p_mkt_buy + m.p_mkt_sell > 1.0 + 1e-9)
+      throw std::invalid_argument("EventGenerator: a regime's event probabilities must sum to at most 1");
+    const double p[kTypes] = { m.p_limit_buy, m.p_limit_sell, m.p_mkt_buy, m.p_mkt_sell,
+                               1.0 - (m.p_limit_buy + m.p_limit_sell + m.p_mkt_buy + m.p_mkt_sell) };
+    for (std::size_t k = 0; k < kTypes; ++k) rate_[r][k] = lambda * std::max(0.0, p[k]);
+    rate_[r][kRegimeClock] = lambda * std::clamp(1.0 - p_stay[r], 0.0, 1.0);
+  }
+  // mean = 1/p for the shifted geometric on {1,2,...}
+  log_q_limit_  = log_fail(cfg.mean_limit_qty  <= 1.0 ? 1.0 : 1.0 / cfg.mean_limit_qty);
+  log_q_market_ = log_fail(cfg.mean_market_qty <= 1.0 ? 1.0 : 1.0 / cfg.mean_market_qty);
+  double a = cfg.geolap_alpha;
+  if (a <= 0.0) a = 1.0;
+  if (a > 1.0)  a = 1.0;
+  log_q_offset_ = log_fail(a);
+  max_offset_   = cfg.max_offset_ticks;
+  start_clocks();
+}
+
+// Exp(1) by inversion, U in (0, 1]
+static double exp1(uint64_t r) { return -std::log(1.0 - to_unit(r)); }
+
+RegimePath::RegimePath(const SimConfig& cfg, uint64_t key) : key_(key) {
+  rate_[0] = cfg.regime.low.lambda  * std::clamp(1.0 - cfg.regime.p_LL, 0.0, 1.0);
+  rate_[1] = cfg.regime.high.lambda * std::clamp(1.0 - cfg.regime.p_HH, 0.0, 1.0);
+  schedule_next(0.0);
+}
+
+void RegimePath::schedule_next(TimePoint from) {
+  const double rate = rate_[int(last_)];
+  if (!(rate > 0.0)) return;   // absorbing: no further switches
+  uint64_t w[2];
+  Philox4x32::words(key_, drawn_, 0, 0, w);
+  clock_.schedule(0, from + exp1(w[0]) / rate);
+}
+
+Regime RegimePath::at(TimePoint t) {
+  while (clock_.pending(0) && clock_.due(0) <= t) {
+    const TimePoint s = clock_.due(0);
+    clock_.pop();
+    switches_.push_back(s);
+    last_ = last_ == Regime::Low ? Regime::High : Regime::Low;
+    ++drawn_;
+    schedule_next(s);
+  }
+  // switches at or before t, counted from the front
+  const auto k = std::upper_bound(switches_.begin(), switches_.end(), t) - switches_.begin();
+  return (k & 1) ? (first_ == Regime::Low ? Regime::High : Regime::Low) : first_;
+}
+
+void RegimePath::forget_before(TimePoint t) {
+  while (!switches_.empty() && switches_.front() <= t) {
+    switches_.pop_front();
+    first_ = first_ == Regime::Low ? Regime::High : Regime::Low;
+  }
+}
+
+// Six seed-only words (a Philox block outside the event counter range,
+// whatever the rng kind) give the clocks their first budgets
+void EventGenerator::start_clocks(TimePoint t0, Regime r) {
+  uint64_t w[2 * ((kProcesses + 1) / 2)];
+  for (uint32_t j = 0; j < (kProcesses + 1) / 2; ++j)
+    Philox4x32::words(key_, ~uint64_t{0}, j, stream_, w + 2 * j);
+
+  t_ = t0;
+  regime_ = r;
+  clocks_.clear();
+  for (std::size_t p = 0; p < kProcesses; ++p) {
+    budget_[p] = exp1(w[p]);
+    const double rate = rate_[int(regime_)][p];
+    if (rate > 0.0) clocks_.schedule(EventScheduler::Id(p), t_ + budget_[p] / rate);
+  }
+}
+
+void EventGenerator::start_at(TimePoint t, Regime r) { start_clocks(t, r); }
+
+EventGenerator::State EventGenerator::state() const {
+  State s{};
+  s.xoshiro    = rng_.state();
+  s.next_event = next_event_;
+  s.t          = t_;
+  for (std::size_t p = 0; p < kProcesses; ++p) {
+    s.due[p]    = clocks_.due(EventScheduler::Id(p));
+    s.budget[p] = budget_[p];
+  }
+  s.rng    = kind_;
+  s.regime = regime_;
+  return s;
+}
+
+// The heap's layout may come back different, but its firing order is
+// fixed by (due, id) alone, so the stream continues draw for draw
+void EventGenerator::restore(const State& s) {
+  if (s.rng != kind_) throw std::invalid_argument("EventGenerator::restore: state is for another rng kind");
+  rng_.set_state(s.xoshiro);
+  next_event_ = s.next_event;
+  t_          = s.t;
+  regime_     = s.regime;
+  clocks_.clear();
+  for (std::size_t p = 0; p < kProcesses; ++p) {
+    budget_[p] = s.budget[p];
+    if (s.due[p] != EventScheduler::kNever) clocks_.schedule(EventScheduler::Id(p), s.due[p]);
+  }
+}
+
+// Rescale every clock to regime `to`'s rates: a pending clock's unspent
+// hazard is (due - now) * old rate; a clock at rate 0 just keeps its budget
+void EventGenerator::switch_regime(Regime to) {
+  const double* from_rate = rate_[int(regime_)];
+  const double* to_rate   = rate_[int(to)];
+  for (std::size_t p = 0; p < kProcesses; ++p) {
+    const auto id = EventScheduler::Id(p);
+    if (clocks_.pending(id)) budget_[p] = (clocks_.due(id) - t_) * from_rate[p];
+    if (to_rate[p] > 0.0) clocks_.schedule(id, t_ + budget_[p] / to_rate[p]);
+    else                  clocks_.cancel(id);
+  }
+  regime_ = to;
+}
+
+/*
+Advance to the next arrival: pop clocks, switching regime on the way if
+the regime clock rings first, until an event type's clock does. That
+clock is rewound with a fresh Exp(1) budget from w6; regime holding
+times come from w0 (and a splitmix64 chain on it, should the regime
+switch more than once before this event).
+*/
+EventType EventGenerator::arrive(uint64_t w0, uint64_t w6) {
+  uint64_t chain = w0;
+  for (bool first = true;;) {
+    const EventScheduler::Id p = clocks_.top();
+    t_ = clocks_.top_time();
+    if (p == kRegimeClock) {
+      clocks_.pop();
+      budget_[p] = exp1(first ? w0 : splitmix64(chain));
+      first = false;
+      switch_regime(regime_ == Regime::Low ? Regime::High : Regime::Low);
+      continue;
+    }
+    // rewinding the top in place is one sift-down, not a pop and a push
+    clocks_.schedule(p, t_ + exp1(w6) / rate_[int(regime_)][p]);
+    return EventType(p);
+  }
+}
+
+/*
+Raw words for the next n events. Xoshiro just continues its stream.
+Philox computes word pair j of event e from the counter (e, j, stream):
+no state is carried between events, so the loop has no dependency
+chain and the order we visit events in does not matter.
+*/
+void EventGenerator::draw_raw(std::size_t n) {
+  raw_.resize(n * kWordsPerEvent);
+  if (kind_ == RngKind::Xoshiro) {
+    static_assert(kWordsPerEvent % Xoshiro256x4::kLanes == 0, "events must use whole RNG steps");
+    rng_.fill(raw_.data(), n * kWordsPerEvent / Xoshiro256x4::kLanes);
+    return;
+  }
+  static_assert(kWordsPerEvent % 2 == 0, "Philox blocks are two words");
+  for (std::size_t i = 0; i < n; ++i) {
+    uint64_t* w = &raw_[i * kWordsPerEvent];
+    for (uint32_t j = 0; j < kWordsPerEvent / 2; ++j)
+      Philox4x32::words(key_, next_event_ + i, j, stream_, w + 2 * j);
+  }
+}
+
+// Replays only what the clocks read: words 0 and 6, i.e. blocks 0 and 3
+void EventGenerator::seek(uint64_t event) {
+  if (kind_ != RngKind::Philox)
+    throw std::logic_error("EventGenerator::seek needs the Philox rng");
+  start_clocks();
+  uint64_t lo[2], hi[2];
+  for (uint64_t e = 0; e < event; ++e) {
+    Philox4x32::words(key_, e, 0, stream_, lo);
+    Philox4x32::words(key_, e, 3, stream_, hi);
+    arrive(lo[0], hi[0]);
+  }
+  next_event_ = event;
+}
+
+void EventGenerator::fill(EventBatch& b, std::size_t n) { fill(b, n, nullptr, 0.0); }
+
+void EventGenerator::fill(EventBatch& b, std::size_t n, RegimePath* common, double follow) {
+  if (b.regime.size() < n) b.resize(n);
+  draw_raw(n);
+
+  // 1) arrivals: the only sequential dependency (clocks and regime)
+  for (std::size_t i = 0; i < n; ++i) {
+    const uint64_t* w = &raw_[i * kWordsPerEvent];
+    if (common && to_unit(w[7]) < follow) {
+      const Regime c = common->at(t_);
+      if (c != regime_) switch_regime(c);
+    }
+    b.type[i]   = arrive(w[0], w[6]);
+    b.regime[i] = regime_;
+    b.ts_ns[i]  = int64_t(t_ * 1e9);
+  }
+
+  // 2) per-row draws, independent across rows
+  for (std::size_t i = 0; i < n; ++i) {
+    const uint64_t* w = &raw_[i * kWordsPerEvent];
+    const EventType t = b.type[i];
+
+    const bool mkt = (t == EventType::MktBuy || t == EventType::MktSell);
+    b.qty[i] = uint32_t(std::min<int64_t>(geometric1(w[2], mkt ? log_q_market_ : log_q_limit_),
+                                          std::numeric_limits<uint32_t>::max()));
+
+    // unbounded (max_offset_ticks 0) the tail can pass what an int32 holds
+    int64_t k = geometric1(w[3], log_q_offset_);
+    k = std::min<int64_t>(k, max_offset_ > 0 ? max_offset_ : std::numeric_limits<int32_t>::max());
+    b.offset[i] = int32_t((w[4] >> 63) ? k : -k);
+
+    if      (t == EventType::LimitBuy  || t == EventType::MktBuy)  b.side[i] = Side::Buy;
+    else if (t == EventType::LimitSell || t == EventType::MktSell) b.side[i] = Side::Sell;
+    else b.side[i] = ((w[4] >> 62) & 1u) ? Side::Buy : Side::Sell; // Cancel fallback
+
+    b.pick[i] = uint32_t(w[5] >> 32);
+  }
+  b.n = n;
+  next_event_ += n;
+}
@@ -0,0 +1,102 @@
+#include "event_log.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+
+static std::runtime_error io_error(const std::string& what, const std::string& path) {
+  return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+FillRecord FillRecord::from(const Fill& f) {
+  FillRecord r;
+  r.ts_ns      = int64_t(std::llround(f.ts * 1e9));
+  r.taker_id   = f.taker_id;
+  r.maker_id   = f.maker_id;
+  r.price      = f.price;
+  r.qty        = uint32_t(f.qty);
+  r.taker_side = f.taker_side;
+  r.maker_tag  = f.maker_tag;
+  return r;
+}
+
+// ---- writer ----
+
+void EventLogWriter::File::open(const std::string& p, const char (&magic)[8],
+                                uint32_t record_size, std::size_t cap) {
+  path = p;
+  fd = ::open(p.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) throw io_error("cannot create", p);
+  buf.resize(std::max<std::size_t>(cap, 4096));
+
+  const LogHeader h = LogHeader::make(magic, record_size);
+  std::memcpy(buf.data(), &h, sizeof h);
+  used = sizeof h;
+}
+
+void EventLogWriter::File::flush() {
+  const char* p = buf.data();
+  std::size_t left = used;
+  while (left) {
+    const ssize_t n = ::write(fd, p, left);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw io_error("write failed on", path);
+    }
+    p += n;
+    left -= std::size_t(n);
+  }
+  used = 0;
+}
+
+void EventLogWriter::File::close() {
+  if (fd < 0) return;
+  flush();
+  if (::close(fd) != 0) { fd = -1; throw io_error("close failed on", path); }
+  fd = -1;
+}
+
+EventLogWriter::EventLogWriter(const std::string& path, bool with_fills, std::size_t buffer_bytes) {
+  events_.open(path, kEventMagic, sizeof(SimEvent), buffer_bytes);
+  if (with_fills) fills_.open(path + ".fills", kFillMagic, sizeof(FillRecord), buffer_bytes);
+}
+
+EventLogWriter::~EventLogWriter() {
+  try { close(); } catch (...) {}
+}
+
+void EventLogWriter::flush() {
+  if (events_.fd >= 0) events_.flush();
+  if (fills_.fd >= 0)  fills_.flush();
+}
+
+void EventLogWriter::close() {
+  events_.close();
+  fills_.close();
+}
+
+// ---- reader ----
+
+template <class Record>
+MappedLog<Record>::MappedLog(const std::string& path) : file_(path) {
+  if (file_.size() < sizeof(LogHeader)) throw std::runtime_error("not an event log: " + path);
+
+  LogHeader h;
+  std::memcpy(&h, file_.data(), sizeof h);
+  const char* magic = std::is_same_v<Record, SimEvent> ? kEventMagic : kFillMagic;
+  if (std::memcmp(h.magic, magic, sizeof h.magic) != 0) throw std::runtime_error("wrong magic in " + path);
+  if (h.byte_order != LogHeader::kByteOrder)      throw std::runtime_error("foreign byte order in " + path);
+  if (h.version != LogHeader::kVersion)           throw std::runtime_error("unsupported version in " + path);
+  if (h.record_size != sizeof(Record))            throw std::runtime_error("record size mismatch in " + path);
+
+  // records start right after the 32-byte header; mmap is page aligned,
+  // so they stay 8-byte aligned
+  first_ = reinterpret_cast<const Record*>(file_.data() + sizeof(LogHeader));
+  n_ = (file_.size() - sizeof(LogHeader)) / sizeof(Record);
+}
+
+template class MappedLog<SimEvent>;
+template class MappedLog<FillRecord>;
@@ -0,0 +1,81 @@
+#include "itch.hpp"
+
+// Order::ts is in seconds; ITCH stamps are ns since midnight
+static TimePoint itch_time(uint64_t ts_ns) { return TimePoint(ts_ns) * 1e-9; }
+
+void ItchBook::add(uint64_t ref, Side s, uint32_t price, uint32_t shares, uint64_t ts_ns) {
+  if (ext.contains(ref)) { ++stats.dup_ref; return; }
+  if (shares == 0 || price == 0) return; // nothing to rest
+  const OrderId id = next_id_++;
+  book.add_limit({ id, s, OrdType::Limit, Price(price), Qty(shares), itch_time(ts_ns) });
+  ext.insert(ref, id);
+}
+
+void ItchBook::take(uint64_t ref, uint32_t shares) {
+  const OrderId id = ext.find(ref);
+  if (!id) { ++stats.unknown_ref; return; }
+  if (shares == 0) return;
+  if (book.reduce(id, Qty(shares)) == 0) ext.erase(ref); // fully filled / cancelled
+}
+
+bool ItchBook::remove(uint64_t ref) {
+  const OrderId id = ext.erase(ref);
+  if (!id) { ++stats.unknown_ref; return false; }
+  book.cancel(id);
+  return true;
+}
+
+void ItchBook::apply(const ItchMsg& m) {
+  switch (m.type) {
+    case 'A': case 'F':
+      ++stats.adds;
+      add(m.ref, m.side, m.price, m.shares, m.ts_ns);
+      break;
+    case 'E': case 'C':
+      ++stats.executes;
+      take(m.ref, m.shares);
+      break;
+    case 'X':
+      ++stats.cancels;
+      take(m.ref, m.shares);
+      break;
+    case 'D':
+      ++stats.deletes;
+      remove(m.ref);
+      break;
+    case 'U': {
+      // the replacement keeps the side; it goes to the back of its new level
+      ++stats.replaces;
+      const OrderId id = ext.find(m.ref);
+      if (!id) { ++stats.unknown_ref; break; }
+      const Side s = book.find(id)->side;
+      remove(m.ref);
+      add(m.new_ref, s, m.price, m.shares, m.ts_ns);
+      break;
+    }
+  }
+}
+
+std::size_t ItchFeed::instruments() const {
+  std::size_t n = 0;
+  for (const auto& b : books_) n += b ? 1 : 0;
+  return n;
+}
+
+std::size_t ItchFeed::resting() const {
+  std::size_t n = 0;
+  for (const auto& b : books_) if (b) n += b->book.resting();
+  return n;
+}
+
+ItchBook::Stats ItchFeed::totals() const {
+  ItchBook::Stats t;
+  for (const auto& b : books_) {
+    if (!b) continue;
+    t.adds += b->stats.adds;         t.executes += b->stats.executes;
+    t.cancels += b->stats.cancels;   t.deletes += b->stats.deletes;
+    t.replaces += b->stats.replaces; t.unknown_ref += b->stats.unknown_ref;
+    t.dup_ref += b->stats.dup_ref;
+  }
+  return t;
+}
@@ -3,37 +3,46 @@
 #include "order_book.hpp"
 #include "matching_engine.hpp"
 #include "sim.hpp"
+#include "strategies.hpp"
+#include "sweep.hpp"
+#include "checkpoint.hpp"
+#include "multi_sim.hpp"
+#include "event_log.hpp"
+#include "itch.hpp"
+#include "mapped_file.hpp"
+#include "config_file.hpp"
+#include <sys/stat.h>
 #include <cstring>
+#include <chrono>
+#include <optional>
 
 // Simple pretty-printers for quick sanity checks
-static void dump_side(const char* name,
-                      const std::map<Price, LevelQueue, std::less<Price>>& asks) {
-  std::cout << name << " (low→high):\n";
-  for (const auto& [px, q] : asks) {
+template <class Side_>
+static void dump_levels(const OrderBook& ob, const Side_& side) {
+  side.for_each_level([&](Price px, const LevelQueue& q) {
     std::cout << "  " << px << " : [";
-    for (size_t i = 0; i < q.size(); ++i) {
-      std::cout << q[i].id << ":" << q[i].qty << (i + 1 < q.size() ? ", " : "");
-    }
+    std::size_t i = 0;
+    ob.for_each(q, [&](const RestingOrder& o) {
+      std::cout << o.id << ":" << o.qty << (++i < q.size() ? ", " : "");
+    });
     std::cout << "]\n";
-  }
+  });
 }
 
-static void dump_side(const char* name,
-                      const std::map<Price, LevelQueue, std::greater<Price>>& bids) {
+static void dump_side(const char* name, const OrderBook& ob, const AskSide& asks) {
+  std::cout << name << " (low→high):\n";
+  dump_levels(ob, asks);
+}
+
+static void dump_side(const char* name, const OrderBook& ob, const BidSide& bids) {
   std::cout << name << " (high→low):\n";
-  for (const auto& [px, q] : bids) {
-    std::cout << "  " << px << " : [";
-    for (size_t i = 0; i < q.size(); ++i) {
-      std::cout << q[i].id << ":" << q[i].qty << (i + 1 < q.size() ? ", " : "");
-    }
-    std::cout << "]\n";
-  }
+  dump_levels(ob, bids);
 }
 
 static void dump_book(const OrderBook& ob) {
   std::cout << "================ BOOK ================\n";
-  dump_side("ASKS", ob.asks);
-  dump_side("BIDS", ob.bids);
+  dump_side("ASKS", ob, ob.asks);
+  dump_side("BIDS", ob, ob.bids);
   std::cout << "best_bid=" << ob.best_bid()
             << " best_ask=" << ob.best_ask()
             << " mid="      << ob.mid() << "\n";
@@ -52,58 +61,468 @@ static void dump_fills(const std::vector<Fill>& fills) {
   if (fills.empty()) std::cout << "(no trades)\n";
 }
 
+/*
+Parallel version of the M3 sweeps: the same three one-parameter grids
+around `base`, each point run under `n_seeds` consecutive seeds from
+base.seed, reduced to mean / sd / 95% CI across seeds.
+*/
+static void run_seed_sweep(const SimConfig& base, unsigned n_seeds, unsigned threads,
+                           size_t warmup) {
+  const uint64_t seed0 = base.seed;
+  std::vector<SweepPoint> grid;
+  auto point = [&](std::string label, auto edit) {
+    SimConfig sc = base;
+    edit(sc);
+    grid.push_back({std::move(label), sc});
+  };
+  for (double a : {0.08, 0.15, 0.30})
+    point("alpha=" + std::to_string(a), [a](SimConfig& sc) { sc.geolap_alpha = a; });
+  for (double p : {0.05, 0.15, 0.35})
+    point("keep_cross_prob=" + std::to_string(p), [p](SimConfig& sc) { sc.keep_cross_prob = p; });
+  for (int m : {5, 20, 50})
+    point("max_offset_ticks=" + std::to_string(m), [m](SimConfig& sc) { sc.max_offset_ticks = m; });
+
+  std::vector<uint64_t> seeds;
+  for (unsigned k = 0; k < n_seeds; ++k) seeds.push_back(seed0 + k);
+
+  using clock = std::chrono::steady_clock;
+  std::cout << "===== seed sweep: " << grid.size() << " points x " << seeds.size()
+            << " seeds =====\n";
+
+  // one warm-up of the base config (under a seed outside the sweep's),
+  // that every run then forks from
+  std::optional<Checkpoint> warm;
+  if (warmup) {
+    SimConfig wc = base;
+    wc.seed       = seed0 + n_seeds;
+    wc.max_events = warmup;
+    const auto w0 = clock::now();
+    Simulator w(wc);
+    w.simulate();
+    warm.emplace(w.checkpoint());
+    std::cout << "warmup events=" << warmup << " resting=" << warm->header().orders
+              << " wall_s=" << std::chrono::duration<double>(clock::now() - w0).count() << "\n";
+  }
+
+  auto t0 = clock::now();
+  const auto results = run_sweep(grid, seeds, threads, warm ? &*warm : nullptr);
+  auto t1 = clock::now();
+  print_sweep(std::cout, results);
+  std::cout << "\nsweep_runs=" << grid.size() * seeds.size()
+            << " wall_s=" << std::chrono::duration<double>(t1 - t0).count() << "\n";
+}
+
+// Universe of n_symbols books, each run from `base`, sharded across threads
+static void run_multi(const SimConfig& base, uint32_t n_symbols, unsigned shards,
+                      double follow) {
+  MultiSimConfig mc;
+  mc.base = base;
+  mc.n_symbols = n_symbols;
+  mc.shards = shards;
+  mc.regime_follow = follow;
+
+  MultiSimulator ms(mc);
+  std::cout << "===== multi-symbol: " << n_symbols << " symbols on " << ms.shards()
+            << " shards, " << mc.base.max_events << " events each, regime_follow="
+            << follow << " =====\n";
+  const MultiSimResult r = ms.run();
+  const StatsSummary s = summarize(r.symbols.data(), r.symbols.size());
+  std::cout << "avg_spread mean=" << s.avg_spread.mean << " ci95=+/-" << s.avg_spread.ci95
+            << " max_drawdown mean=" << s.max_drawdown.mean
+            << " trades mean=" << s.trades.mean << "\n"
+            << "events=" << r.events << " wall_s=" << r.wall_s
+            << " events_per_sec=" << r.events_per_sec() << "\n";
+}
+
+// Replay a binary event log into a fresh book and check it against the
+// logged fills when <path>.fills exists
+static int run_replay(const std::string& path, BookBackend backend) {
+  using clock = std::chrono::steady_clock;
+  EventLogReader log(path);
+
+  std::unique_ptr<FillLogReader> expect;
+  struct stat st{};
+  if (::stat((path + ".fills").c_str(), &st) == 0) expect = std::make_unique<FillLogReader>(path + ".fills");
+
+  OrderBook ob(backend);
+  MatchingEngine me(ob);
+  size_t k = 0, mismatches = 0;
+  auto check = [&](const Fill& f) {
+    if (!expect) return;
+    if (k >= expect->size() || !FillRecord::from(f).same_trade((*expect)[k])) ++mismatches;
+    ++k;
+  };
+
+  auto t0 = clock::now();
+  const ReplayResult r = replay(log.begin(), log.end(), ob, me, check);
+  auto t1 = clock::now();
+  const double s = std::chrono::duration<double>(t1 - t0).count();
+
+  std::cout << "===== replay " << path << " =====\n"
+            << "events=" << r.events << " limits=" << r.limits << " markets=" << r.markets
+            << " cancels=" << r.cancels << " trades=" << r.fills << " vol=" << r.volume << "\n"
+            << "wall_s=" << s << " events_per_sec=" << (s > 0 ? double(r.events) / s : 0.0)
+            << " MB_per_sec=" << (s > 0 ? double(r.events * sizeof(SimEvent)) / s / 1e6 : 0.0) << "\n";
+  if (!ob.self_check()) { std::cerr << "self_check failed after replay!\n"; return 1; }
+  if (expect) {
+    if (k != expect->size()) ++mismatches;
+    std::cout << "fills_checked=" << k << " logged=" << expect->size()
+              << (mismatches ? " MISMATCH" : " match") << "\n";
+    if (mismatches) return 1;
+  }
+  return 0;
+}
+
+// Decode an ITCH 5.0 capture twice: once decode-only, once decode + apply
+// to per-instrument books. Prints both rates.
+static int run_itch(const std::string& path, BookBackend backend, uint16_t locate) {
+  using clock = std::chrono::steady_clock;
+  MappedFile f(path);
+  auto secs = [](auto a, auto b) { return std::chrono::duration<double>(b - a).count(); };
+
+  itch::DecodeStats ds;
+  uint64_t sink = 0;
+  auto t0 = clock::now();
+  const size_t used = itch::decode(f.data(), f.size(), [&](const ItchMsg& m) { sink += m.ref; }, ds);
+  auto t1 = clock::now();
+
+  ItchFeed feed(backend, locate);
+  itch::DecodeStats as;
+  auto t2 = clock::now();
+  itch::decode(f.data(), f.size(), feed, as);
+  auto t3 = clock::now();
+
+  const double d = secs(t0, t1), a = secs(t2, t3);
+  const ItchBook::Stats t = feed.totals();
+  std::cout << "===== itch " << path << " (" << f.size() << " bytes) =====\n"
+            << "messages=" << ds.messages << " book=" << ds.book << " skipped=" << ds.skipped
+            << " bad=" << ds.bad << " trailing_bytes=" << f.size() - used << "\n"
+            << "decode: wall_s=" << d << " msgs_per_sec=" << (d > 0 ? double(ds.messages) / d : 0.0)
+            << " MB_per_sec=" << (d > 0 ? double(used) / d / 1e6 : 0.0) << " (chk " << (sink & 0xff) << ")\n"
+            << "apply:  wall_s=" << a << " msgs_per_sec=" << (a > 0 ? double(as.messages) / a : 0.0) << "\n"
+            << "adds=" << t.adds << " executes=" << t.executes << " cancels=" << t.cancels
+            << " deletes=" << t.deletes << " replaces=" << t.replaces
+            << " unknown_ref=" << t.unknown_ref << " dup_ref=" << t.dup_ref << "\n"
+            << "instruments=" << feed.instruments() << " resting=" << feed.resting() << "\n";
+
+  if (locate) {
+    if (const ItchBook* b = feed.book(locate)) {
+      const OrderBook& ob = b->book;
+      std::cout << "locate=" << locate << " best_bid=" << ob.best_bid() << " best_ask=" << ob.best_ask()
+                << " bid_levels=" << ob.bids.size() << " ask_levels=" << ob.asks.size()
+                << " resting=" << ob.resting() << "\n";
+      if (!ob.self_check()) { std::cerr << "self_check failed after itch apply!\n"; return 1; }
+    }
+  }
+  return 0;
+}
+
+// The --run-sim market: what a config file or --set starts from
+static SimConfig run_sim_defaults() {
+  SimConfig sc;
+  sc.seed           = 42;
+  sc.max_events     = 200000;
+
+  // regime switching
+  sc.regime.p_LL     = 0.995;  // stay-low probability
+  sc.regime.p_HH     = 0.990;  // stay-high probability
+  sc.regime.low.lambda  = 800.0;
+  sc.regime.high.lambda = 2000.0;
+
+  // low regime
+  sc.regime.low.mix.p_limit_buy  = 0.35;
+  sc.regime.low.mix.p_limit_sell = 0.35;
+  sc.regime.low.mix.p_mkt_buy    = 0.10;
+  sc.regime.low.mix.p_mkt_sell   = 0.10;
+
+  // high regime
+  sc.regime.high.mix.p_limit_buy  = 0.28;
+  sc.regime.high.mix.p_limit_sell = 0.28;
+  sc.regime.high.mix.p_mkt_buy    = 0.18;
+  sc.regime.high.mix.p_mkt_sell   = 0.18;
+
+  // qty distribution means
+  sc.mean_limit_qty  = 50.0;
+  sc.mean_market_qty = 50.0;
+
+  // price model
+  sc.initial_mid_ticks = 10000;
+  sc.min_price_ticks   = 1;
+  sc.max_offset_ticks  = 50;
+  sc.geolap_alpha      = 0.15; 
+  sc.keep_cross_prob   = 0.15;
+  return sc;
+}
+
+// Every --config FILE / --set KEY=VALUE of the command line, in order, onto c
+static void apply_config_args(SimConfig& c, int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if      (!std::strcmp(argv[i], "--config")) load_config(c, argv[++i]);
+    else if (!std::strcmp(argv[i], "--set"))    set_config(c, argv[++i]);
+  }
+}
+
+// Throws what a Simulator built from c would (std::invalid_argument for a
+// setting it refuses), without its side effects: no log files opened
+static void check_config(SimConfig c) {
+  c.event_log.clear();
+  c.log_trades = false;
+  c.snapshot_path.clear();
+  BareSimulator probe(c);
+}
+
 int main(int argc, char** argv) {
+  // --- config: each mode's defaults (run_sim_defaults for --run-sim,
+  // m3_sweep_base for the sweeps and --multi), then the --config / --set
+  // settings; the flags below start from it and override it ---
+  const SimConfig defaults = run_sim_defaults();
+  SimConfig base = defaults;
+  SimConfig sweep_base = m3_sweep_base();
+  try {
+    apply_config_args(base, argc, argv);
+    apply_config_args(sweep_base, argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << "config: " << e.what() << "\n";
+    return 1;
+  }
+
     // --- CLI flags ---
   bool run_sim = false;
-  size_t max_events = 200000;
-  uint64_t seed = 42;
+  bool print_config = false;     // --print-config: the resolved config of the mode, then exit
+  bool run_sweep_mode = false;
+  unsigned n_seeds = 16;
+  unsigned threads = 0;          // 0 = all cores
+  bool events_given = base.max_events != defaults.max_events; // a config counts
+  uint32_t n_symbols = 0;        // --multi N
+  unsigned shards = 0;           // 0 = all cores
+  double follow = 0.0;           // regime correlation across symbols
+  std::string log_path = base.event_log;  // --log-events PATH (with --run-sim)
+  bool log_fills = base.event_log_fills;
+  std::string replay_path;       // --replay PATH
+  std::string snap_path = base.snapshot_path;  // --snapshots PATH (with --run-sim)
+  uint32_t    snap_every = base.snapshot_every ? base.snapshot_every : 1000; // --snapshot-every N
+  uint32_t    snap_depth = base.snapshot_depth;      // --depth N
+  uint32_t    snap_full  = base.snapshot_full_every; // --full-every K
+  std::string itch_path;         // --itch PATH [--locate N]
+  bool log_trades = base.log_trades;  // --log-trades [PATH] [--binary] [--drop]
+  std::string trade_path = base.trade_log;
+  TradeLogFormat trade_fmt = base.trade_log_format;
+  Backpressure trade_bp = base.trade_log_policy;
+  uint16_t itch_locate = 0;
+  BookBackend backend = base.book_backend;
+  RngKind rng = base.rng;
+  bool pipeline = base.pipeline;
+  WaitStrategy wait = base.pipeline_wait;
+  size_t max_events = base.max_events;
+  uint32_t n_makers = 0;         // --makers N: QuotingMakers in the --run-sim book
+  Qty      twap_qty = 0;         // --twap QTY: one TWAP buyer working QTY
+  std::string ckpt_in;           // --checkpoint PATH: start --run-sim from it [--fork]
+  std::string ckpt_out;          // --save-checkpoint PATH: after --run-sim
+  bool        ckpt_fork = false;
+  size_t      warmup = 0;        // --warmup N: --sweep runs fork from an N-event warm-up
+  double      auction_every = base.auction_interval; // --auction SECONDS: periodic call auctions [--pro-rata]
+  Allocation  auction_alloc = base.auction_allocation;
+  uint64_t seed = base.seed;
 
   for (int i = 1; i < argc; ++i) {
     if (!std::strcmp(argv[i], "--run-sim")) run_sim = true;
-    else if (!std::strcmp(argv[i], "--events") && i + 1 < argc) max_events = std::stoull(argv[++i]);
+    else if ((!std::strcmp(argv[i], "--config") || !std::strcmp(argv[i], "--set")) && i + 1 < argc) ++i; // read above
+    else if (!std::strcmp(argv[i], "--print-config")) print_config = true;
+    else if (!std::strcmp(argv[i], "--ladder")) backend = BookBackend::Ladder;
+    else if (!std::strcmp(argv[i], "--philox")) rng = RngKind::Philox;
+    else if (!std::strcmp(argv[i], "--pipeline")) pipeline = true;
+    else if (!std::strcmp(argv[i], "--wait") && i + 1 < argc) {
+      const char* w = argv[++i];
+      if      (!std::strcmp(w, "spin"))  wait = WaitStrategy::Spin;
+      else if (!std::strcmp(w, "yield")) wait = WaitStrategy::Yield;
+      else if (!std::strcmp(w, "park"))  wait = WaitStrategy::Park;
+      else {
+        std::cerr << "unknown --wait strategy: " << w << "\n";
+        return 1;
+      }
+    }
+    else if (!std::strcmp(argv[i], "--sweep")) run_sweep_mode = true;
+    else if (!std::strcmp(argv[i], "--seeds") && i + 1 < argc) n_seeds = unsigned(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) threads = unsigned(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--multi") && i + 1 < argc) n_symbols = uint32_t(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--shards") && i + 1 < argc) shards = unsigned(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--corr") && i + 1 < argc) follow = std::stod(argv[++i]);
+    else if (!std::strcmp(argv[i], "--log-events") && i + 1 < argc) log_path = argv[++i];
+    else if (!std::strcmp(argv[i], "--log-fills")) log_fills = true;
+    else if (!std::strcmp(argv[i], "--replay") && i + 1 < argc) replay_path = argv[++i];
+    else if (!std::strcmp(argv[i], "--itch") && i + 1 < argc) itch_path = argv[++i];
+    else if (!std::strcmp(argv[i], "--snapshots") && i + 1 < argc) snap_path = argv[++i];
+    else if (!std::strcmp(argv[i], "--snapshot-every") && i + 1 < argc) snap_every = uint32_t(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--depth") && i + 1 < argc) snap_depth = uint32_t(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--full-every") && i + 1 < argc) snap_full = uint32_t(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--log-trades")) {
+      log_trades = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-') trade_path = argv[++i];
+    }
+    else if (!std::strcmp(argv[i], "--binary")) trade_fmt = TradeLogFormat::Binary;
+    else if (!std::strcmp(argv[i], "--drop")) trade_bp = Backpressure::Drop;
+    else if (!std::strcmp(argv[i], "--locate") && i + 1 < argc) itch_locate = uint16_t(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--events") && i + 1 < argc) {
+      max_events = std::stoull(argv[++i]);
+      events_given = true;
+    }
     else if (!std::strcmp(argv[i], "--seed") && i + 1 < argc) seed = std::stoull(argv[++i]);
+    else if (!std::strcmp(argv[i], "--makers") && i + 1 < argc) n_makers = uint32_t(std::stoul(argv[++i]));
+    else if (!std::strcmp(argv[i], "--twap") && i + 1 < argc) twap_qty = Qty(std::stoll(argv[++i]));
+    else if (!std::strcmp(argv[i], "--checkpoint") && i + 1 < argc) ckpt_in = argv[++i];
+    else if (!std::strcmp(argv[i], "--save-checkpoint") && i + 1 < argc) ckpt_out = argv[++i];
+    else if (!std::strcmp(argv[i], "--fork")) ckpt_fork = true;
+    else if (!std::strcmp(argv[i], "--warmup") && i + 1 < argc) warmup = size_t(std::stoull(argv[++i]));
+    else if (!std::strcmp(argv[i], "--auction") && i + 1 < argc) auction_every = std::stod(argv[++i]);
+    else if (!std::strcmp(argv[i], "--pro-rata")) auction_alloc = Allocation::ProRata;
+  }
+
+  // the --run-sim config: base with the flags on top
+  SimConfig run_cfg = base;
+  run_cfg.seed            = seed;
+  run_cfg.max_events      = max_events;
+  run_cfg.snapshot_every  = snap_path.empty() ? 0 : snap_every; // header print off
+  run_cfg.snapshot_path   = snap_path;
+  run_cfg.snapshot_depth  = snap_depth;
+  run_cfg.snapshot_full_every = snap_full;
+  run_cfg.log_trades      = log_trades; // async writer; off by default
+  run_cfg.trade_log       = trade_path;
+  run_cfg.trade_log_format= trade_fmt;
+  run_cfg.trade_log_policy= trade_bp;
+  run_cfg.book_backend    = backend;
+  run_cfg.rng             = rng;
+  run_cfg.pipeline        = pipeline;
+  run_cfg.pipeline_wait   = wait;
+  run_cfg.event_log       = log_path;
+  run_cfg.event_log_fills = log_fills;
+  run_cfg.auction_interval   = auction_every;
+  run_cfg.auction_allocation = auction_alloc;
+
+  // --sweep / --multi: the sweep base with the same flags on top. Their
+  // runs share one config, so per-run outputs (logs, snapshots) are out.
+  sweep_base.book_backend = backend;
+  sweep_base.rng          = rng;
+  // the M3 demo sweeps at the end: not --seed / --events, and none of the
+  // per-run outputs, which belong to the --run-sim run they follow
+  SimConfig demo_base = sweep_base;
+  demo_base.event_log.clear();
+  demo_base.event_log_fills = false;
+  demo_base.log_trades = false;
+  demo_base.trade_log.clear();
+  demo_base.snapshot_path.clear();
+  sweep_base.seed         = seed;
+  if (events_given)    sweep_base.max_events = max_events;
+  else if (n_symbols)  sweep_base.max_events = 20000;
+  const bool sweeping = n_symbols || run_sweep_mode;
+  if (sweeping && (!sweep_base.event_log.empty() || sweep_base.log_trades ||
+                   !sweep_base.snapshot_path.empty())) {
+    std::cerr << "config: event_log, log_trades and snapshot_path are per run, not for --sweep / --multi\n";
+    return 1;
+  }
+
+  if (print_config) {
+    write_config(std::cout, sweeping ? sweep_base : run_cfg);
+    return 0;
+  }
+
+  // settings the Simulator would refuse fail here, once, before any run
+  // (some of them would otherwise only throw on a worker thread)
+  try {
+    if (sweeping) {
+      check_config(sweep_base);
+    } else if (replay_path.empty() && itch_path.empty()) {
+      check_config(run_cfg);
+      check_config(demo_base);
+    }
+  } catch (const std::invalid_argument& e) {
+    std::cerr << "config: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (!replay_path.empty()) {
+    try {
+      return run_replay(replay_path, backend);
+    } catch (const std::exception& e) {
+      std::cerr << "replay: " << e.what() << "\n";
+      return 1;
+    }
+  }
+
+  if (!itch_path.empty()) {
+    try {
+      return run_itch(itch_path, backend, itch_locate);
+    } catch (const std::exception& e) {
+      std::cerr << "itch: " << e.what() << "\n";
+      return 1;
+    }
+  }
+
+  if (n_symbols) {
+    try {
+      run_multi(sweep_base, n_symbols, shards, follow);
+    } catch (const std::exception& e) {
+      std::cerr << "multi: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
+  if (run_sweep_mode) {
+    try {
+      run_seed_sweep(sweep_base, n_seeds, threads, warmup);
+    } catch (const std::exception& e) {
+      std::cerr << "sweep: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
   }
 
   if (run_sim) {
     // ---- Milestone 3 simulation run ----
-    SimConfig sc;
-    sc.seed            = 42;
-    sc.max_events      = 200000;
-    sc.snapshot_every  = 0;      // heartbeat off
-    sc.log_trades      = false;  // leave off for speed
-
-    // regime switching
-    sc.regime.p_LL     = 0.995;  // stay-low probability
-    sc.regime.p_HH     = 0.990;  // stay-high probability
-    sc.regime.low.lambda  = 800.0;
-    sc.regime.high.lambda = 2000.0;
-
-    // low regime
-    sc.regime.low.mix.p_limit_buy  = 0.35;
-    sc.regime.low.mix.p_limit_sell = 0.35;
-    sc.regime.low.mix.p_mkt_buy    = 0.10;
-    sc.regime.low.mix.p_mkt_sell   = 0.10;
-
-    // high regime
-    sc.regime.high.mix.p_limit_buy  = 0.28;
-    sc.regime.high.mix.p_limit_sell = 0.28;
-    sc.regime.high.mix.p_mkt_buy    = 0.18;
-    sc.regime.high.mix.p_mkt_sell   = 0.18;
-
-    // qty distribution means
-    sc.mean_limit_qty  = 50.0;
-    sc.mean_market_qty = 50.0;
-
-    // price model
-    sc.initial_mid_ticks = 10000;
-    sc.min_price_ticks   = 1;
-    sc.max_offset_ticks  = 50;
-    sc.geolap_alpha      = 0.15; 
-    sc.keep_cross_prob   = 0.15;
-
-    // run M3
-    Simulator sim(sc);
-    sim.run();
+    const SimConfig& sc = run_cfg;
+
+    // agents: makers quoting 1..n_makers ticks wide, a TWAP buyer slicing
+    // its parent order every 0.5 sim seconds
+    AgentSet<QuotingMaker, TwapExecutor> agents;
+    for (uint32_t k = 0; k < n_makers; ++k)
+      agents.add<QuotingMaker>(Qty(10), Price(1 + k % 5), Price(2), int64_t(500));
+    if (twap_qty > 0) agents.add<TwapExecutor>(Side::Buy, twap_qty, std::max<Qty>(1, twap_qty / 100), 0.5);
+
+    // run M3; a config the Simulator refuses (std::invalid_argument,
+    // e.g. an event log with call auctions) or a log it cannot open ends
+    // the run with a message
+    std::optional<Simulator> sim;
+    try {
+      sim.emplace(sc);
+    } catch (const std::exception& e) {
+      std::cerr << "sim: " << e.what() << "\n";
+      return 1;
+    }
+    if (!ckpt_in.empty()) {
+      try {
+        sim->restore(Checkpoint(ckpt_in), ckpt_fork ? Resume::Fork : Resume::Continue);
+      } catch (const std::exception& e) {
+        std::cerr << "checkpoint: " << e.what() << "\n";
+        return 1;
+      }
+      std::cout << "[sim] restored " << ckpt_in << " at t=" << sim->now() << "\n";
+    }
+    if (agents.size()) sim->attach(agents);
+    try {
+      sim->run();
+    } catch (const std::exception& e) {
+      std::cerr << "sim: " << e.what() << "\n";
+      return 1;
+    }
+    if (!ckpt_out.empty()) {
+      try {
+        sim->checkpoint().save(ckpt_out);
+      } catch (const std::exception& e) {
+        std::cerr << "checkpoint: " << e.what() << "\n";
+        return 1;
+      }
+      std::cout << "[sim] checkpoint written to " << ckpt_out << "\n";
+    }
     std::cout << "=== SIM DONE ===\n";
   }
   
@@ -239,33 +658,7 @@ MatchingEngine me(ob);
 
   {
   std::cout << "\n===== M3 sweeps =====\n";
-  auto base = [&](){
-    SimConfig sc{};
-    sc.seed             = 42;
-    sc.max_events       = 50000;      // keep small for quick sweeps
-    sc.snapshot_every   = 0;          // disable snapshots for speed
-    sc.regime.p_LL      = 0.995;
-    sc.regime.p_HH      = 0.990;
-    sc.regime.low.lambda  = 800.0;
-    sc.regime.high.lambda = 2000.0;
-    sc.regime.low.mix.p_limit_buy  = 0.35;
-    sc.regime.low.mix.p_limit_sell = 0.35;
-    sc.regime.low.mix.p_mkt_buy    = 0.10;
-    sc.regime.low.mix.p_mkt_sell   = 0.10;
-    sc.regime.high.mix.p_limit_buy  = 0.28;
-    sc.regime.high.mix.p_limit_sell = 0.28;
-    sc.regime.high.mix.p_mkt_buy    = 0.18;
-    sc.regime.high.mix.p_mkt_sell   = 0.18;
-    sc.mean_limit_qty   = 50.0;
-    sc.mean_market_qty  = 50.0;
-    sc.initial_mid_ticks= 10000;
-    sc.min_price_ticks  = 1;
-    sc.max_offset_ticks = 20;
-    sc.geolap_alpha     = 0.15;
-    sc.keep_cross_prob  = 0.15;
-    sc.log_trades       = false;
-    return sc;
-  };
+  auto base = [&](){ return demo_base; };
 
   auto run = [&](const char* label, SimConfig sc){
     std::cout << "\n--- " << label << " ---\n";
@@ -0,0 +1,34 @@
+#include "mapped_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path, bool sequential) : path_(path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) {
+    const int err = errno;
+    ::close(fd);
+    throw std::runtime_error("cannot stat " + path + ": " + std::strerror(err));
+  }
+  len_ = std::size_t(st.st_size);
+  if (len_ == 0) { ::close(fd); return; }
+
+  map_ = ::mmap(nullptr, len_, PROT_READ, MAP_PRIVATE, fd, 0);
+  const int err = errno;
+  ::close(fd); // the mapping keeps the file alive
+  if (map_ == MAP_FAILED) {
+    map_ = nullptr;
+    throw std::runtime_error("mmap failed on " + path + ": " + std::strerror(err));
+  }
+  if (sequential) ::madvise(map_, len_, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+  if (map_) ::munmap(map_, len_);
+}
@@ -0,0 +1,166 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
+// Two-sided 95% Student t critical values for 1..30 degrees of freedom;
+// past that the normal 1.96 is close enough
+static double t95(size_t df) {
+  static const double T[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+  if (df == 0) return 0.0;
+  return df <= 30 ? T[df - 1] : 1.960;
+}
+
+double Welford::sd() const { return std::sqrt(var()); }
+
+// Welford's update, so long sweeps don't lose precision to sum-of-squares
+MetricSummary summarize(const std::vector<double>& xs) {
+  Welford w;
+  for (double x : xs) w.add(x);
+  MetricSummary s;
+  s.n    = w.n;
+  s.mean = w.mean;
+  if (s.n > 1) {
+    s.sd   = w.sd();
+    s.ci95 = t95(s.n - 1) * s.sd / std::sqrt(double(s.n));
+  }
+  return s;
+}
+
+StatsSummary summarize(const SimStats* runs, size_t n) {
+  StatsSummary out;
+  out.runs = n;
+  std::vector<double> xs(n);
+
+  auto col = [&](auto get) {
+    for (size_t i = 0; i < n; ++i) xs[i] = double(get(runs[i]));
+    return summarize(xs);
+  };
+  out.avg_spread   = col([](const SimStats& r) { return r.avg_spread; });
+  out.slip_buy_vw  = col([](const SimStats& r) { return r.slip_buy_vw; });
+  out.slip_sell_vw = col([](const SimStats& r) { return r.slip_sell_vw; });
+  out.max_drawdown = col([](const SimStats& r) { return r.max_drawdown; });
+  out.trades       = col([](const SimStats& r) { return r.trades; });
+  for (int b = 0; b < 5; ++b)
+    out.fill_ratio[b] = col([b](const SimStats& r) { return r.fill_ratio(b); });
+  return out;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& o) {
+  for (std::size_t i = 0; i < kBuckets; ++i) counts_[i] += o.counts_[i];
+  total_ += o.total_;
+  max_ = std::max(max_, o.max_);
+}
+
+uint64_t LatencyHistogram::quantile(double q) const {
+  if (total_ == 0) return 0;
+  const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(q * double(total_))));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < kBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return std::min(max_, lower_bound(i + 1) - 1);
+  }
+  return max_;
+}
+
+void LatencyProfile::print(std::ostream& os, const char* const type_names[kTypes]) const {
+  static const char* kStageNames[kStages] = {"generate", "resolve", "match", "telemetry"};
+  const double ns = clock.ns_per_tick();
+  auto line = [&](const char* what, const char* name, const LatencyHistogram& h) {
+    if (!h.count()) return;
+    os << "latency_ns " << what << "=" << name
+       << " n="     << h.count()
+       << " p50="   << double(h.quantile(0.50))  * ns
+       << " p99="   << double(h.quantile(0.99))  * ns
+       << " p99.9=" << double(h.quantile(0.999)) * ns
+       << " max="   << double(h.max()) * ns << "\n";
+  };
+  for (std::size_t i = 0; i < kStages; ++i) line("stage", kStageNames[i], stage[i]);
+  for (std::size_t i = 0; i < kTypes; ++i)  line("type", type_names[i], by_type[i]);
+}
+
+void FlowCounters::report(SimStats& st) const {
+  st.limits  = limits;
+  st.markets = markets;
+  st.cancels = cancels;
+  st.trades  = trades;
+  st.vol     = vol;
+}
+
+// Offset of a new limit from mid, in ticks, measured on the book it
+// arrives at (only when that book is two-sided; bucket 0 otherwise)
+int8_t FillByDistance::on_limit(Side s, Price px, const OrderBook& ob) {
+  int k = 0;
+  if (!ob.bids.empty() && !ob.asks.empty()) {
+    const Price mid = (ob.best_bid() + ob.best_ask()) / 2;
+    const Price off = s == Side::Buy ? px - mid : mid - px;  // positive if through mid
+    k = int(std::abs(off));
+    if (max_offset > 0 && k > max_offset) k = max_offset;
+
+    ++offset_count;
+    offset_abs_sum += uint64_t(k);
+    if (k < int(offset_hist.size())) ++offset_hist[k];
+  }
+  const int b = bucket_of(k);
+  ++total[b];
+  return int8_t(b);
+}
+
+void FillByDistance::report(SimStats& st) const {
+  st.lim_total  = total;
+  st.lim_filled = filled;
+}
+
+void SpreadMidStats::on_event(const SimEvent& e, const OrderBook& ob) {
+  ++events;
+  if (ob.bids.empty() || ob.asks.empty()) return;
+  const Price bb = ob.best_bid(), ba = ob.best_ask();
+  const Price mid = (bb + ba) / 2;
+  const double spr = double(ba - bb);
+
+  sum_spread += spr;
+  spread.add(spr);
+  spread_hist.record(uint64_t(std::max<Price>(ba - bb, 0)));
+  tw_spread.update(double(e.ts_ns) * 1e-9, spr);
+
+  sum_mid += double(mid);
+  ++mid_samples;
+  if (mid > peak_mid) peak_mid = mid;
+  if (peak_mid - mid > max_drawdown) max_drawdown = peak_mid - mid;
+}
+
+void SpreadMidStats::report(SimStats& st) const {
+  st.avg_spread   = events ? sum_spread / double(events) : 0.0;
+  st.avg_mid      = mid_samples ? sum_mid / double(mid_samples) : 0.0;
+  st.max_drawdown = int(max_drawdown);
+  st.spread_sd    = spread.sd();
+  st.spread_p50   = double(spread_hist.quantile(0.50));
+  st.spread_p99   = double(spread_hist.quantile(0.99));
+  st.tw_spread    = tw_spread.mean();
+}
+
+void Slippage::report(SimStats& st) const {
+  st.slip_buy_vw  = buy_qty  ? buy  / double(buy_qty)  : 0.0;
+  st.slip_sell_vw = sell_qty ? sell / double(sell_qty) : 0.0;
+}
+
+void ArrivalRate::on_window(TimePoint) {
+  if (!(width > 0.0)) return;
+  const double r = double(in_window) / width;
+  if (window_rate.n == 0 || r < min_rate) min_rate = r;
+  if (window_rate.n == 0 || r > max_rate) max_rate = r;
+  window_rate.add(r);
+  in_window = 0;
+}
+
+void ArrivalRate::report(SimStats& st) const {
+  st.sim_seconds        = last_t - t0;
+  st.events_per_sim_sec = st.sim_seconds > 0.0 ? double(events) / st.sim_seconds : 0.0;
+  st.windows            = window_rate.n;
+  st.window_eps_min     = min_rate;
+  st.window_eps_max     = max_rate;
+  st.window_eps_sd      = window_rate.sd();
+}
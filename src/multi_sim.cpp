@@ -0,0 +1,127 @@
+#include "multi_sim.hpp"
+#include "event_gen.hpp"
+#include "rng.hpp"
+#include "sim.hpp"
+#include "spsc_ring.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// What crosses a ring: one pre-drawn event for one of the shard's symbols
+struct RoutedEvent {
+  uint32_t  local;   // index among the shard's symbols; kEnd = no more events
+  SimEvent  draw;    // unresolved
+};
+constexpr uint32_t kEnd = UINT32_MAX;
+
+} // namespace
+
+MultiSimulator::MultiSimulator(const MultiSimConfig& cfg) : cfg_(cfg) {
+  if (cfg_.n_symbols == 0) throw std::invalid_argument("MultiSimulator needs at least one symbol");
+  shards_ = cfg_.shards ? cfg_.shards : std::max(1u, std::thread::hardware_concurrency());
+  shards_ = std::min<unsigned>(shards_, cfg_.n_symbols);
+}
+
+SimConfig MultiSimulator::symbol_config(const SimConfig& base, SymbolId s) {
+  SimConfig c = base;
+  c.event_log.clear();  // one file per Simulator; not supported across a universe
+  c.snapshot_path.clear();
+  if (c.rng == RngKind::Philox) {
+    c.stream = s;
+  } else {
+    uint64_t x = base.seed ^ (uint64_t(s) * 0x9E3779B97F4A7C15ull);
+    c.seed = splitmix64(x);
+  }
+  return c;
+}
+
+MultiSimResult MultiSimulator::run() {
+  using clock = std::chrono::steady_clock;
+  const uint32_t n     = cfg_.n_symbols;
+  const size_t   per   = cfg_.base.max_events;
+  const size_t   batch = cfg_.base.gen_batch ? cfg_.base.gen_batch : 1;
+
+  MultiSimResult res;
+  res.symbols.resize(n);
+
+  std::vector<std::unique_ptr<SpscRing<RoutedEvent>>> rings;
+  for (unsigned k = 0; k < shards_; ++k)
+    rings.push_back(std::make_unique<SpscRing<RoutedEvent>>(cfg_.ring_capacity));
+
+  // Shard k owns symbols k, k + shards, k + 2*shards, ... Books are built
+  // on the shard's own thread, so their memory is first touched there.
+  // A shard that throws parks the exception for run() to rethrow after
+  // join, and keeps draining its ring so the router never blocks on it.
+  std::vector<std::exception_ptr> errors(shards_);
+  auto shard = [&](unsigned k) {
+    RoutedEvent ev;
+    bool ended = false;
+    try {
+      std::vector<std::unique_ptr<Simulator>> books;
+      for (SymbolId s = k; s < n; s += shards_)
+        books.push_back(std::make_unique<Simulator>(symbol_config(cfg_.base, s)));
+
+      for (;;) {
+        rings[k]->pop(ev);
+        if (ev.local == kEnd) break;
+        books[ev.local]->apply(ev.draw);
+      }
+      ended = true;
+      for (size_t i = 0; i < books.size(); ++i)
+        res.symbols[k + i * shards_] = books[i]->stats(); // own slots only
+    } catch (...) {
+      errors[k] = std::current_exception();
+      while (!ended) {
+        rings[k]->pop(ev);
+        ended = ev.local == kEnd;
+      }
+    }
+  };
+
+  // Router state: one generator per symbol plus the market regime, a
+  // process in sim time under its own key (so it does not depend on how
+  // the run is batched), read by each symbol at its own clock
+  std::vector<EventGenerator> gens;
+  gens.reserve(n);
+  for (SymbolId s = 0; s < n; ++s) gens.emplace_back(symbol_config(cfg_.base, s));
+
+  uint64_t mseed = cfg_.base.seed ^ 0x6D61726B65747267ull; // separate from every symbol
+  RegimePath market(cfg_.base, splitmix64(mseed));
+  const bool coupled = cfg_.regime_follow > 0.0;
+
+  auto t0 = clock::now();
+  std::vector<std::thread> pool;
+  for (unsigned k = 0; k < shards_; ++k) pool.emplace_back(shard, k);
+
+  EventBatch b;
+  for (size_t done = 0; done < per; ) {
+    const size_t m = std::min(batch, per - done);
+    // a batch per symbol, each routed to its shard in draw order
+    TimePoint slowest = EventScheduler::kNever;
+    for (SymbolId s = 0; s < n; ++s) {
+      if (coupled) gens[s].fill(b, m, &market, cfg_.regime_follow);
+      else         gens[s].fill(b, m);
+      slowest = std::min(slowest, gens[s].now());
+      auto& q = *rings[shard_of(s)];
+      const uint32_t local = s / shards_;
+      for (size_t j = 0; j < m; ++j) q.push(RoutedEvent{local, b.row(j)});
+    }
+    // no symbol reads the market before its own clock again
+    if (coupled) market.forget_before(slowest);
+    done += m;
+  }
+  for (auto& q : rings) q->push(RoutedEvent{kEnd, {}});
+  for (auto& t : pool) t.join();
+  auto t1 = clock::now();
+  for (const auto& e : errors)
+    if (e) std::rethrow_exception(e);
+
+  res.events = size_t(n) * per;
+  res.wall_s = std::chrono::duration<double>(t1 - t0).count();
+  return res;
+}
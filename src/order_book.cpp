@@ -1,10 +1,92 @@
 #include "order_book.hpp"
+#include <algorithm>
 #include <stdexcept> // throw "thats not allowed" errors
 #include <cstddef> // std::size_t, std::ptrdiff_t, etc
 #include <iterator> 
 #include <cassert>
 
 
+/*
+Every resting order lives in a node from the pool. A node knows the order
+in front of it and the order behind it at the same price, so a price level
+is just a line of nodes: head (oldest) ... tail (newest).
+
+Handles are pool slots, so they never move while the order rests. That is
+what lets index point straight at the node instead of at a position.
+
+Live nodes are also kept in a dense list (live_) so a random resting order
+can be picked in O(1); removing one swaps the last entry into its spot.
+*/
+
+OrderHandle OrderBook::alloc_node(const Order& o) {
+  OrderHandle h;
+  const auto slot = static_cast<uint32_t>(live_.size());
+  const RestingOrder node{ o.id, o.limit_price, o.qty, o.ts, kNullHandle, kNullHandle, slot, o.side, o.tag };
+  if (!free_.empty()) {
+    h = free_.back();
+    free_.pop_back();
+    nodes_[h] = node;
+  } else {
+    h = static_cast<OrderHandle>(nodes_.size());
+    nodes_.push_back(node);
+  }
+  live_.push_back(h);
+  return h;
+}
+
+void OrderBook::free_node(OrderHandle h) {
+  RestingOrder& n = nodes_[h];
+  const OrderHandle last = live_.back();
+  live_[n.live_slot] = last;
+  nodes_[last].live_slot = n.live_slot;
+  live_.pop_back();
+
+  n.prev = kNullHandle;
+  n.next = kNullHandle;
+  free_.push_back(h);
+}
+
+void OrderBook::reserve(std::size_t n) {
+  nodes_.reserve(n);
+  live_.reserve(n);
+  index.reserve(n);
+}
+
+void OrderBook::reorder_resting(const OrderId* ids, std::size_t n) {
+  if (n != live_.size()) throw std::invalid_argument("reorder_resting: not every resting order");
+  for (std::size_t k = 0; k < n; ++k) {
+    const OrderHandle h = index.find(ids[k]);
+    if (h == kNullHandle) throw std::invalid_argument("reorder_resting: id is not resting");
+    live_[k] = h;
+    nodes_[h].live_slot = uint32_t(k);
+  }
+  // a repeated id leaves some earlier slot pointing at a node that moved on
+  for (std::size_t k = 0; k < n; ++k)
+    if (nodes_[live_[k]].live_slot != k) throw std::invalid_argument("reorder_resting: repeated id");
+}
+
+void OrderBook::link_back(LevelQueue& q, OrderHandle h) {
+  RestingOrder& n = nodes_[h];
+  n.prev = q.tail;
+  n.next = kNullHandle;
+  if (q.tail != kNullHandle) nodes_[q.tail].next = h;
+  else                       q.head = h;
+  q.tail = h;
+  ++q.count;
+  q.total_qty += n.qty;
+}
+
+void OrderBook::unlink(LevelQueue& q, OrderHandle h) {
+  RestingOrder& n = nodes_[h];
+  if (n.prev != kNullHandle) nodes_[n.prev].next = n.next;
+  else                       q.head = n.next;
+  if (n.next != kNullHandle) nodes_[n.next].prev = n.prev;
+  else                       q.tail = n.prev;
+  --q.count;
+  q.total_qty -= n.qty;
+}
+
+
 /*
 When a limit order shows up, we:
 
@@ -14,19 +96,22 @@ Make sure no duplicate IDs.
 
 Make sure quantity and price are positive.
 
-If Buy, put the order at the back of the buy queue.
-If it’s a Sell, do the same on the sell side.
+Take a node from the pool and copy the order into it.
+
+Link the node at the back of its level on its own side. The side is a
+template parameter from here on, so each side gets its own copy of the
+code with the right container baked in.
 
-Remember where it was in a hash map: for this OrderId, store its side, price, and position in the queue at that price level.
+Remember where it is in the index: for this OrderId, store its node handle (the node itself knows side and price).
 
-So the order book is like shelves by price, each shelf is a line (deque) of orders in FIFO. We put a new order on the right shelf, at the end of the line, and write down exactly where we put it so we can find it later.
+So the order book is like shelves by price, each shelf is a line of orders in FIFO. We put a new order on the right shelf, at the end of the line, and write down which node it sits in so we can find it later.
 */
 
 void OrderBook::add_limit(const Order& o) {
   if (o.type != OrdType::Limit) {
     throw std::invalid_argument("add_limit expects OrdType::Limit");
   }
-  if (index.find(o.id) != index.end()) {
+  if (index.contains(o.id)) {
     throw std::invalid_argument("Duplicate OrderId");
   }
   if (o.qty <= 0) {
@@ -36,18 +121,19 @@ void OrderBook::add_limit(const Order& o) {
     throw std::invalid_argument("limit_price must be > 0");
   }
 
-  // Choose the side explicitly; avoid mixing comparator types
-  if (o.side == Side::Buy) {
-    auto& q = bids[o.limit_price];   // creates level if missing
-    q.push_back(o);
-    const std::size_t pos = q.size() - 1;
-    index.emplace(o.id, IndexEntry{ Side::Buy, o.limit_price, pos });
-  } else {
-    auto& q = asks[o.limit_price];
-    q.push_back(o);
-    const std::size_t pos = q.size() - 1;
-    index.emplace(o.id, IndexEntry{ Side::Sell, o.limit_price, pos });
-  }
+  if (o.side == Side::Buy) add_to<Side::Buy>(o);
+  else                     add_to<Side::Sell>(o);
+}
+
+template <Side S>
+void OrderBook::add_to(const Order& o) {
+  // the level first: creating it is what may throw (PriceLadder::kMaxTicks),
+  // and then nothing has been taken from the pool yet
+  auto& q = side<S>()[o.limit_price];   // creates level if missing
+  const OrderHandle h = alloc_node(o);
+  link_back(q, h);
+  index.insert(o.id, h);
+  mark_dirty(S, o.limit_price);
 }
 
 
@@ -56,110 +142,270 @@ Want to cancel an order by its ID:
 
 Look up the order in index. If don’t know, just stop.
 
-From the index card, learn:
+From the index card, learn which node holds it (h). The node tells us:
   Which side (Buy/Sell) it’s on,
-  Which price shelf (px),
-  Which spot in the line (pos).
+  Which price shelf (px).
 
 Go to the correct shelf (buy or sell) at that price.
-  If somehow that shelf doesn’t exist anymore, clean up the index and stop.
-  If the position is nonsense (out of range), clean up the index and stop.
-
-Remove the order from the line at that position.
+  If somehow that shelf doesn’t exist anymore, just recycle the node.
 
-Because we pulled a order out of the middle of the line, everyone behind it moves up by one. Update the index positions for those orders.
+Unhook the node from its neighbours and give it back to the pool.
+Nobody else in the line moves, so no other index card needs updating.
 
 If the shelf became empty, remove the shelf entirely.
 
-Finally, remove this order’s card from the index.
+The index card is torn up first (one probe finds and removes it).
 */
 
-void OrderBook::cancel(OrderId id) {
-  auto it = index.find(id);
-  if (it == index.end()) return; // not found
+bool OrderBook::cancel(OrderId id) {
+  const OrderHandle h = index.erase(id);
+  if (h == kNullHandle) return false; // not found
 
-  const Side side = it->second.side;
-  const Price px  = it->second.px;
-  std::size_t pos = it->second.pos;
+  if (nodes_[h].side == Side::Buy) remove_from<Side::Buy>(h);
+  else                              remove_from<Side::Sell>(h);
+  return true;
+}
 
-  // Get the right side’s map
-  if (side == Side::Buy) {
-    auto lvl_it = bids.find(px);
-    if (lvl_it == bids.end()) { index.erase(it); return; }
+template <Side S>
+void OrderBook::remove_from(OrderHandle h) {
+  const Price px = nodes_[h].limit_price;
+  mark_dirty(S, px);
+  auto& levels = side<S>();
+  if (LevelQueue* q = levels.find(px)) {
+    unlink(*q, h);
+    if (q->empty()) levels.erase(px);
+  }
+  free_node(h);
+}
 
-    LevelQueue& q = lvl_it->second;
-    if (pos >= q.size()) { index.erase(it); return; }
+OrderId OrderBook::evict_worst(Side s) {
+  return s == Side::Buy ? evict_from<Side::Buy>() : evict_from<Side::Sell>();
+}
 
-    auto erase_it = q.begin() + static_cast<std::ptrdiff_t>(pos);
-    q.erase(erase_it);
+template <Side S>
+OrderId OrderBook::evict_from() {
+  auto& levels = side<S>();
+  if (levels.empty()) return 0;
+  const OrderHandle h = levels.find(levels.worst_price())->tail;
+  const OrderId id = nodes_[h].id;
+  index.erase(id);
+  remove_from<S>(h);
+  return id;
+}
 
-    // Re-index subsequent orders at the same price level
-    for (std::size_t p = pos; p < q.size(); ++p) {
-      auto idx_it = index.find(q[p].id);
-      if (idx_it != index.end()) idx_it->second.pos = p;
-    }
+/*
+Shrinking an order keeps its place in line: only its qty changes, so the
+node stays linked where it is. Taking all of it (or more) is a cancel.
+*/
 
-    if (q.empty()) bids.erase(lvl_it);
-  } else {
-    auto lvl_it = asks.find(px);
-    if (lvl_it == asks.end()) { index.erase(it); return; }
+Qty OrderBook::reduce(OrderId id, Qty by) {
+  const OrderHandle h = index.find(id);
+  if (h == kNullHandle) return 0;
+  if (by <= 0) throw std::invalid_argument("reduce qty must be > 0");
+  RestingOrder& o = nodes_[h];
+  if (by >= o.qty) {
+    cancel(id);
+    return 0;
+  }
+  o.qty -= by;
+  LevelQueue* q = (o.side == Side::Buy) ? bids.find(o.limit_price) : asks.find(o.limit_price);
+  q->total_qty -= by;
+  mark_dirty(o.side, o.limit_price);
+  return o.qty;
+}
 
-    LevelQueue& q = lvl_it->second;
-    if (pos >= q.size()) { index.erase(it); return; }
 
-    auto erase_it = q.begin() + static_cast<std::ptrdiff_t>(pos);
-    q.erase(erase_it);
+/*
+Moving an order is a cancel and an add that keep the node: unhook it
+from its old level (dropping the level if that empties it), update the
+order, hook it onto the back of the new one. The index maps id -> node
+handle and the handle does not change, so the index is never touched.
+*/
 
-    for (std::size_t p = pos; p < q.size(); ++p) {
-      auto idx_it = index.find(q[p].id);
-      if (idx_it != index.end()) idx_it->second.pos = p;
-    }
+bool OrderBook::move(OrderId id, Price px, Qty qty, TimePoint ts) {
+  if (qty <= 0) throw std::invalid_argument("qty must be positive");
+  if (px <= 0)  throw std::invalid_argument("limit_price must be > 0");
+  const OrderHandle h = index.find(id);
+  if (h == kNullHandle) return false;
+  if (nodes_[h].side == Side::Buy) move_to<Side::Buy>(h, px, qty, ts);
+  else                              move_to<Side::Sell>(h, px, qty, ts);
+  return true;
+}
 
-    if (q.empty()) asks.erase(lvl_it);
+template <Side S>
+void OrderBook::move_to(OrderHandle h, Price px, Qty qty, TimePoint ts) {
+  RestingOrder& o = nodes_[h];
+  auto& levels = side<S>();
+  // the target level first, as in add_to: if creating it throws, the
+  // order is still where it was
+  LevelQueue& dst = levels[px];   // creates level if missing
+  mark_dirty(S, o.limit_price);
+  if (LevelQueue* q = levels.find(o.limit_price)) {
+    unlink(*q, h);
+    if (q->empty() && q != &dst) levels.erase(o.limit_price);
   }
+  o.limit_price = px;
+  o.qty = qty;
+  o.ts  = ts;
+  link_back(dst, h);
+  mark_dirty(S, px);
+}
+
+
+/*
+The matching engine eats a level from the front. The head order is done:
+forget its index card, unhook it and recycle the node. The caller decides
+whether the (possibly now empty) level should go.
+*/
+
+void OrderBook::pop_front(LevelQueue& q) {
+  const OrderHandle h = q.head;
+  index.erase(nodes_[h].id);
+  unlink(q, h);
+  free_node(h);
+}
+
+template <Side S>
+void OrderBook::settle_at(Price px, Qty taken, bool front_only) {
+  auto& levels = side<S>();
+  LevelQueue* q = levels.find(px);
+  if (!q) return;
+  mark_dirty(S, px);
+  q->total_qty -= taken;
+  for (OrderHandle h = q->head; h != kNullHandle; ) {
+    const OrderHandle next = nodes_[h].next;
+    if (nodes_[h].qty == 0) {
+      index.erase(nodes_[h].id);
+      unlink(*q, h);
+      free_node(h);
+    } else if (front_only) {
+      break;
+    }
+    h = next;
+  }
+  if (q->empty()) levels.erase(px);
+}
+
+void OrderBook::settle(Side s, Price px, Qty taken, bool front_only) {
+  if (s == Side::Buy) settle_at<Side::Buy>(px, taken, front_only);
+  else                settle_at<Side::Sell>(px, taken, front_only);
+}
 
-index.erase(it);
+
+/*
+Depth queries only read the level aggregates: n levels cost n steps of
+the level walk, however many orders sit behind them.
+*/
+
+template <Side S>
+void OrderBook::depth_of(std::size_t n, std::vector<DepthLevel>& out) const {
+  if (n == 0) return;
+  side<S>().for_each_level([&](Price px, const LevelQueue& q) {
+    out.push_back(DepthLevel{px, q.total_qty, uint32_t(q.size())});
+    return --n > 0;
+  });
+}
+
+void OrderBook::depth(Side s, std::size_t n, std::vector<DepthLevel>& out) const {
+  out.clear();
+  if (s == Side::Buy) depth_of<Side::Buy>(n, out);
+  else                depth_of<Side::Sell>(n, out);
 }
 
+template <Side S>
+Qty OrderBook::qty_through(Price px) const {
+  Qty sum = 0;
+  side<S>().for_each_level([&](Price level, const LevelQueue& q) {
+    if (SideTraits<S>::better(px, level)) return false; // past px
+    sum += q.total_qty;
+    return true;
+  });
+  return sum;
+}
+
+Qty OrderBook::qty_through(Side s, Price px) const {
+  return s == Side::Buy ? qty_through<Side::Buy>(px) : qty_through<Side::Sell>(px);
+}
+
+template <Side S>
+ImpactEstimate OrderBook::impact_of(Qty qty) const {
+  ImpactEstimate r;
+  r.filled = side<S>().take(qty, r.cost, r.worst, r.levels);
+  return r;
+}
+
+ImpactEstimate OrderBook::estimate_impact(Side taker, Qty qty) const {
+  if (qty <= 0) return {};
+  return taker == Side::Buy ? impact_of<Side::Sell>(qty) : impact_of<Side::Buy>(qty);
+}
 
 /*
 Ensures bid/ask book state and the index state are perfectly synchronized, catching any data corruption or stale references that may occur during operations like add_limit or cancel.
 */
 
 bool OrderBook::self_check() const {
-  // 1) Every order in the book must appear in index with correct side/px/pos
-  auto check_side = [&](const auto& bookSide, Side side) -> bool {
-    for (const auto& [px, q] : bookSide) {
-      for (std::size_t p = 0; p < q.size(); ++p) {
-        const auto& o = q[p];
-        auto it = index.find(o.id);
-        if (it == index.end()) return false;
-        const auto& e = it->second;
-        if (e.side != side || e.px != px || e.pos != p) return false;
-      }
+  std::size_t resting = 0;
+
+  // 1) Every level must be a well-formed chain, and every order in it must
+  //    appear in index with its handle and in the resting list
+  auto check_level = [&](Price px, const LevelQueue& q, Side side) -> bool {
+    if (q.empty()) return false; // empty levels should have been erased
+    std::size_t n = 0;
+    Qty total = 0;
+    OrderHandle prev = kNullHandle;
+    for (OrderHandle h = q.head; h != kNullHandle; h = nodes_[h].next) {
+      if (h >= nodes_.size()) return false;
+      const RestingOrder& o = nodes_[h];
+      if (o.prev != prev) return false;
+      if (o.side != side || o.limit_price != px || o.qty <= 0) return false;
+      if (index.find(o.id) != h) return false;
+      if (o.live_slot >= live_.size() || live_[o.live_slot] != h) return false;
+      prev = h;
+      total += o.qty;
+      if (++n > q.count) return false; // cycle or bad count
     }
+    if (n != q.count || q.tail != prev || total != q.total_qty) return false;
+    resting += n;
     return true;
   };
+  auto check_side = [&](const auto& bookSide, Side side) -> bool {
+    if (!bookSide.consistent()) return false;
+    bool ok = true;
+    Price last = 0;
+    std::size_t levels = 0;
+    bookSide.for_each_level([&](Price px, const LevelQueue& q) {
+      // best-first: bids strictly falling, asks strictly rising
+      if (levels && (side == Side::Buy ? px >= last : px <= last)) ok = false;
+      ok = ok && check_level(px, q, side);
+      last = px;
+      ++levels;
+      return ok;
+    });
+    return ok && levels == bookSide.size();
+  };
 
   if (!check_side(bids, Side::Buy))  return false;
   if (!check_side(asks, Side::Sell)) return false;
 
   // 2) Every index entry must point to a real order in the right place
-  for (const auto& [id, e] : index) {
-    if (e.side == Side::Buy) {
-      auto lvl = bids.find(e.px);
-      if (lvl == bids.end()) return false;
-      const auto& q = lvl->second;
-      if (e.pos >= q.size()) return false;
-      if (q[e.pos].id != id) return false;
+  bool ok = true;
+  index.for_each([&](OrderId id, OrderHandle h) {
+    if (!ok) return;
+    if (h >= nodes_.size()) { ok = false; return; }
+    const RestingOrder& o = nodes_[h];
+    if (o.id != id) { ok = false; return; }
+    if (o.side == Side::Buy) {
+      if (!bids.find(o.limit_price)) ok = false;
     } else { // Side::Sell
-      auto lvl = asks.find(e.px);
-      if (lvl == asks.end()) return false;
-      const auto& q = lvl->second;
-      if (e.pos >= q.size()) return false;
-      if (q[e.pos].id != id) return false;
+      if (!asks.find(o.limit_price)) ok = false;
     }
-  }
+  });
+  if (!ok) return false;
+
+  // 3) Pool accounting: every node is either resting or on the free list,
+  //    and the resting list holds exactly the resting nodes
+  if (resting != index.size() || resting != live_.size()) return false;
+  if (nodes_.size() != resting + free_.size()) return false;
 
   return true;
 }
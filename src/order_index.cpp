@@ -0,0 +1,76 @@
+#include "order_index.hpp"
+#include <utility>
+
+/*
+Robin Hood insert: walk from the home slot; whenever the resident entry is
+closer to its own home than we are to ours, it gives up the slot and we
+carry it forward instead. Runs stay sorted by home slot.
+*/
+
+template <class V, V kEmpty>
+void FlatIndex<V, kEmpty>::place(Slot s) {
+  std::size_t i = home(s.id);
+  for (std::size_t d = 0;; ++d, i = (i + 1) & mask_) {
+    Slot& cur = slots_[i];
+    if (cur.h == kEmpty) { cur = s; return; }
+    const std::size_t cd = dist(i, cur.id);
+    if (cd < d) {
+      std::swap(cur, s);
+      d = cd;
+    }
+  }
+}
+
+/*
+Erase without tombstones: empty the slot, then pull each following entry
+back by one until we hit an empty slot or an entry already at its home
+(nothing past that point could move closer).
+*/
+
+template <class V, V kEmpty>
+V FlatIndex<V, kEmpty>::erase(OrderId id) {
+  std::size_t i = home(id);
+  for (std::size_t d = 0;; ++d, i = (i + 1) & mask_) {
+    const Slot& s = slots_[i];
+    if (s.h == kEmpty || dist(i, s.id) < d) return kEmpty; // not found
+    if (s.id == id) break;
+  }
+  const V h = slots_[i].h;
+
+  for (std::size_t j = (i + 1) & mask_;
+       slots_[j].h != kEmpty && dist(j, slots_[j].id) > 0;
+       j = (j + 1) & mask_) {
+    slots_[i] = slots_[j];
+    i = j;
+  }
+  slots_[i] = Slot{};
+  --size_;
+  return h;
+}
+
+template <class V, V kEmpty>
+void FlatIndex<V, kEmpty>::grow() { rehash(slots_.size() * 2); }
+
+// One rehash straight to the final table, not a doubling per step
+template <class V, V kEmpty>
+void FlatIndex<V, kEmpty>::reserve(std::size_t n) {
+  std::size_t want = slots_.size();
+  while (2 * n > want) want *= 2;
+  if (want != slots_.size()) rehash(want);
+}
+
+// Move every entry into a fresh table of `slots` (a power of two)
+template <class V, V kEmpty>
+void FlatIndex<V, kEmpty>::rehash(std::size_t slots) {
+  std::pmr::vector<Slot> old(slots, Slot{}, slots_.get_allocator());
+  old.swap(slots_);
+  mask_ = slots_.size() - 1;
+  shift_ = 64;
+  for (std::size_t k = slots_.size(); k > 1; k >>= 1) --shift_;
+  for (const Slot& s : old) {
+    if (s.h != kEmpty) place(s);
+  }
+}
+
+template class FlatIndex<OrderHandle, kNullHandle>;
+template class FlatIndex<OrderId, OrderId{0}>;
@@ -0,0 +1,75 @@
+#include "scheduler.hpp"
+
+void EventScheduler::resize(std::size_t processes) {
+  heap_.clear();
+  heap_.reserve(processes);
+  pos_.assign(processes, kNone);
+}
+
+void EventScheduler::clear() {
+  for (const Entry& e : heap_) pos_[e.id] = kNone;
+  heap_.clear();
+}
+
+// Hole-moving sifts: shift entries over the hole, write the moved one once
+void EventScheduler::sift_up(std::size_t i) {
+  const Entry e = heap_[i];
+  while (i > 0) {
+    const std::size_t parent = (i - 1) / 2;
+    if (!before(e, heap_[parent])) break;
+    put(i, heap_[parent]);
+    i = parent;
+  }
+  put(i, e);
+}
+
+void EventScheduler::sift_down(std::size_t i) {
+  const Entry e = heap_[i];
+  const std::size_t n = heap_.size();
+  for (;;) {
+    std::size_t c = 2 * i + 1;
+    if (c >= n) break;
+    if (c + 1 < n && before(heap_[c + 1], heap_[c])) ++c;
+    if (!before(heap_[c], e)) break;
+    put(i, heap_[c]);
+    i = c;
+  }
+  put(i, e);
+}
+
+void EventScheduler::schedule(Id id, TimePoint t) {
+  if (pending(id)) {
+    const std::size_t i = pos_[id];
+    const bool earlier = t < heap_[i].t;
+    heap_[i].t = t;
+    if (earlier) sift_up(i);
+    else         sift_down(i);
+    return;
+  }
+  heap_.push_back({t, id});
+  pos_[id] = uint32_t(heap_.size() - 1);
+  sift_up(heap_.size() - 1);
+}
+
+// Move the last entry into slot i and restore the heap from there
+void EventScheduler::remove_at(std::size_t i) {
+  pos_[heap_[i].id] = kNone;
+  const Entry last = heap_.back();
+  heap_.pop_back();
+  if (i == heap_.size()) return;
+  put(i, last);
+  if (i > 0 && before(last, heap_[(i - 1) / 2])) sift_up(i);
+  else                                          sift_down(i);
+}
+
+bool EventScheduler::cancel(Id id) {
+  if (!pending(id)) return false;
+  remove_at(pos_[id]);
+  return true;
+}
+
+EventScheduler::Id EventScheduler::pop() {
+  const Id id = heap_.front().id;
+  remove_at(0);
+  return id;
+}
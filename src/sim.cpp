@@ -1,83 +1,62 @@
 #include "sim.hpp"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
-#include <limits>
+#include <thread>
 
-static double mean_to_geom_p(double mean) {
-  if (mean <= 1.0) return 1.0;
-  return 1.0 / mean; // mean = 1/p for shifted geometric on {1,2,...}
-}
-
-static inline int bucket_of(int k) {
-  if (k == 0) return 0;   // exactly at mid
-  if (k <= 2) return 1;   // 1–2 ticks
-  if (k <= 5) return 2;   // 3–5
-  if (k <= 10) return 3;  // 6–10
-  return 4;               // >10
-}
-
-Simulator::Simulator(const SimConfig& cfg)
+template <class Obs>
+BasicSimulator<Obs>::BasicSimulator(const SimConfig& cfg)
   : cfg_(cfg),
-    ob_(),               // we own the order book
+    ob_(cfg.book_backend), // we own the order book
     me_(ob_),            // MatchingEngine requires OrderBook&
-    rng_(cfg.seed) {}
-
-double Simulator::draw_exp(double lambda) {
-  if (lambda <= 0.0) return 0.0;
-  std::uniform_real_distribution<double> U(0.0, 1.0);
-  double u = std::max(U(rng_), std::numeric_limits<double>::min());
-  return -std::log(u) / lambda;
-}
-
-Qty Simulator::draw_geometric_mean(double mean) {
-  double p = mean_to_geom_p(mean);
-  std::geometric_distribution<int> G(p); // {0,1,2,...}
-  return static_cast<Qty>(G(rng_) + 1);  // shift -> {1,2,...}
-}
-
-int Simulator::draw_two_sided_offset() {
-  double a = cfg_.geolap_alpha;
-  if (a <= 0.0) a = 1.0;
-  if (a > 1.0)  a = 1.0;
-  std::geometric_distribution<int> G(a);
-  int k = G(rng_) + 1;
-  if (cfg_.max_offset_ticks > 0) k = std::min(k, cfg_.max_offset_ticks);
-  std::bernoulli_distribution B(0.5);
-  return B(rng_) ? k : -k;
-}
-
-void Simulator::maybe_switch_regime() {
-  std::bernoulli_distribution stay_low(cfg_.regime.p_LL);
-  std::bernoulli_distribution stay_high(cfg_.regime.p_HH);
-  regime_ = (regime_ == Regime::Low)
-              ? (stay_low(rng_) ? Regime::Low : Regime::High)
-              : (stay_high(rng_) ? Regime::High : Regime::Low);
-}
-
-const RegimeMix& Simulator::mix_for(Regime r) const {
-  return (r == Regime::Low) ? cfg_.regime.low.mix : cfg_.regime.high.mix;
+    gen_(cfg) {
+  obs_.configure(cfg_);
+  if (Obs::kEnabled && cfg_.metrics_window > 0.0) timers_.schedule(kMetricsWindow, cfg_.metrics_window);
+  if (!cfg_.event_log.empty())
+    log_ = std::make_unique<EventLogWriter>(cfg_.event_log, cfg_.event_log_fills);
+  if (cfg_.log_trades)
+    trades_ = std::make_unique<TradeLogger>(cfg_.trade_log, cfg_.trade_log_format,
+                                            cfg_.trade_log_policy);
+  if (cfg_.snapshot_every && !cfg_.snapshot_path.empty())
+    snaps_ = std::make_unique<L2Snapshotter>(cfg_.snapshot_path, cfg_.snapshot_depth,
+                                             cfg_.snapshot_full_every);
+  if (cfg_.auction_interval > 0.0) {
+    if (log_) throw std::invalid_argument("Simulator: event logs replay continuous matching, not call auctions");
+    auction_ = std::make_unique<CallAuction>(ob_, me_, cfg_.auction_allocation);
+    timers_.schedule(kAuction, cfg_.auction_interval);
+  }
+  if (cfg_.max_depth_ticks < 0) throw std::invalid_argument("Simulator: max_depth_ticks must be >= 0");
+  bounded_ = cfg_.max_resting > 0 || cfg_.max_depth_ticks > 0;
 }
 
-Price Simulator::current_mid() const {
+template <class Obs>
+Price BasicSimulator<Obs>::current_mid() const {
   Price m = ob_.mid();
   return (m > 0) ? m : cfg_.initial_mid_ticks;
 }
 
-Price Simulator::decide_limit_price(Side s) {
+/*
+Book-dependent pricing. The offset and the keep-cross coin were drawn by
+the generator; here we only look at the book. A price that would cross
+is kept with probability keep_cross_prob, otherwise it is pulled back to
+rest on its own side (at the touch, or |off| away from mid if that side
+is empty).
+*/
+template <class Obs>
+Price BasicSimulator<Obs>::decide_limit_price(Side s, int off, double u_keep) {
   Price mid = current_mid();
-  int off = draw_two_sided_offset();
   Price px = mid + off;
+  const bool keep = u_keep < cfg_.keep_cross_prob;
 
-  // If would cross, pull it back half the time to keep some resting depth
   if (s == Side::Buy) {
-    if (!ob_.asks.empty() && px >= ob_.best_ask()) {
-      std::bernoulli_distribution keep_cross(0.5);
-      if (!keep_cross(rng_)) px = std::min<Price>(ob_.best_bid(), mid - std::abs(off));
+    if (!ob_.asks.empty() && px >= ob_.best_ask() && !keep) {
+      px = mid - std::abs(off);
+      if (!ob_.bids.empty()) px = std::min<Price>(ob_.best_bid(), px);
     }
   } else {
-    if (!ob_.bids.empty() && px <= ob_.best_bid()) {
-      std::bernoulli_distribution keep_cross(0.5);
-      if (!keep_cross(rng_)) px = std::max<Price>(ob_.best_ask(), mid + std::abs(off));
+    if (!ob_.bids.empty() && px <= ob_.best_bid() && !keep) {
+      px = mid + std::abs(off);
+      if (!ob_.asks.empty()) px = std::max<Price>(ob_.best_ask(), px);
     }
   }
 
@@ -85,259 +64,526 @@ Price Simulator::decide_limit_price(Side s) {
   return px;
 }
 
-void Simulator::live_add_if_resting(OrderId id) {
-  // Only add if that id is actually resting in the book
-  if (ob_.index.find(id) == ob_.index.end()) return;
-  if (pos_.count(id)) return;
-  size_t idx = live_ids_.size();
-  live_ids_.push_back(id);
-  pos_[id] = idx;
+template <class Obs>
+OrderId BasicSimulator<Obs>::sample_live(double u) {
+  const std::size_t n = ob_.resting();
+  if (n == 0) return 0;
+  const std::size_t k = std::min(n - 1, static_cast<std::size_t>(u * double(n)));
+  return ob_.resting_at(k);
 }
 
-void Simulator::live_remove(OrderId id) {
-  auto it = pos_.find(id);
-  if (it == pos_.end()) return;
-  size_t idx = it->second;
-  OrderId last = live_ids_.back();
-  live_ids_[idx] = last;
-  pos_[last] = idx;
-  live_ids_.pop_back();
-  pos_.erase(it);
+/*
+Timers fire between events, in time order: one due exactly at an
+event's timestamp rings before that event. The event stream's times come
+from the generator's arrival clocks, so timers never hold events back;
+they only see time jump from one arrival to the next.
+*/
+template <class Obs>
+void BasicSimulator<Obs>::advance(TimePoint t) {
+  while (!timers_.empty() && timers_.top_time() <= t) {
+    const TimePoint due = timers_.top_time();
+    switch (Timer(timers_.pop())) {
+      case kMetricsWindow:
+        if constexpr (Obs::kEnabled) obs_.on_window(due);
+        timers_.schedule(kMetricsWindow, due + cfg_.metrics_window);
+        break;
+      case kAgentTimers: {
+        t_curr_ = due;   // intents sent from timers trade at the timer's time
+        agents_->ring(agent_update(false), intents_);
+        run_intents();
+        notify_agents(false);
+        const TimePoint next = agents_->next_timer();
+        if (next != EventScheduler::kNever) timers_.schedule(kAgentTimers, next);
+        break;
+      }
+      case kAuction: {
+        t_curr_ = due;
+        const AuctionResult r = auction_->uncross(due, [&](const Fill& f) { record(f); });
+        ++auctions_;
+        if (r.volume) { ++auctions_traded_; auction_vol_ += uint64_t(r.volume); }
+        timers_.schedule(kAuction, due + cfg_.auction_interval);
+        break;
+      }
+      case kTimers:
+        break;
+    }
+  }
+  t_curr_ = t;
 }
 
-OrderId Simulator::sample_live() {
-  if (live_ids_.empty()) return 0;
-  std::uniform_int_distribution<size_t> U(0, live_ids_.size() - 1);
-  return live_ids_[U(rng_)];
-}
+// Resolve a drawn event in place against the book: the draw fields are
+// consumed and replaced by the price / cancel target
+template <class Obs>
+void BasicSimulator<Obs>::resolve(SimEvent& ev) {
+  regime_ = ev.regime;
+  advance(ev.ts());
+  const int32_t off  = ev.draw.offset;
+  const double  pick = to_unit32(ev.draw.pick);
 
-SimEvent Simulator::next_event() {
-  // Advance time by exponential inter-arrival at current regime rate
-  double lambda = (regime_ == Regime::Low)
-              ? cfg_.regime.low.lambda
-              : cfg_.regime.high.lambda;
-
-  // Maybe switch regime at the arrival boundary
-  maybe_switch_regime();
-
-  // Choose event type
-  const RegimeMix& mix = mix_for(regime_);
-  std::uniform_real_distribution<double> U(0.0, 1.0);
-  double u = U(rng_);
-
-  double c1 = mix.p_limit_buy;
-  double c2 = c1 + mix.p_limit_sell;
-  double c3 = c2 + mix.p_mkt_buy;
-  double c4 = c3 + mix.p_mkt_sell;
-
-  SimEvent ev{};
-  ev.ts = t_curr_;
-  ev.side = Side::Buy;
-
-  if (u < c1) {
-    ev.type = EventType::LimitBuy;
-    ev.side = Side::Buy;
-    ev.qty = draw_geometric_mean(cfg_.mean_limit_qty);
-    ev.px  = decide_limit_price(Side::Buy);
-  } else if (u < c2) {
-    ev.type = EventType::LimitSell;
-    ev.side = Side::Sell;
-    ev.qty = draw_geometric_mean(cfg_.mean_limit_qty);
-    ev.px  = decide_limit_price(Side::Sell);
-  } else if (u < c3) {
-    ev.type = EventType::MktBuy;
-    ev.side = Side::Buy;
-    ev.qty = draw_geometric_mean(cfg_.mean_market_qty);
-  } else if (u < c4) {
-    ev.type = EventType::MktSell;
-    ev.side = Side::Sell;
-    ev.qty = draw_geometric_mean(cfg_.mean_market_qty);
-  } else {
-    ev.type = EventType::Cancel;
-    OrderId target = sample_live();
-    if (target) ev.cancel_id = target;
-
-    // If nothing to cancel, opportunistically create a limit instead
-    if (!ev.cancel_id) {
-      std::bernoulli_distribution B(0.5);
-      ev.type = B(rng_) ? EventType::LimitBuy : EventType::LimitSell;
-      ev.side = (ev.type == EventType::LimitBuy) ? Side::Buy : Side::Sell;
-      ev.qty  = draw_geometric_mean(cfg_.mean_limit_qty);
-      ev.px   = decide_limit_price(ev.side);
+  switch (ev.type) {
+    case EventType::LimitBuy:
+    case EventType::LimitSell:
+      ev.px = decide_limit_price(ev.side, off, pick);
+      break;
+    case EventType::MktBuy:
+    case EventType::MktSell:
+      ev.px = 0;
+      break;
+    case EventType::Cancel: {
+      OrderId target = sample_live(pick);
+      if (target) { ev.cancel_id = target; break; }
+
+      // If nothing to cancel, opportunistically create a limit instead
+      // (side, qty and offset were drawn for exactly this case)
+      ev.type = (ev.side == Side::Buy) ? EventType::LimitBuy : EventType::LimitSell;
+      ev.px   = decide_limit_price(ev.side, off, pick);
+      break;
     }
   }
-
-  return ev;
+  ev.flags |= SimEvent::kResolved;
 }
 
-void Simulator::execute(const SimEvent& e) {
-  std::vector<Fill> fills;
-
-  switch (e.type) {
-    case EventType::LimitBuy: {
-      int k = 0;
-      if (!ob_.bids.empty() && !ob_.asks.empty() && e.px) {
-        int bb  = ob_.best_bid();
-        int ba  = ob_.best_ask();
-        int mid = (bb + ba) / 2;
-        int off = *e.px - mid;          // positive if above mid
-        k = std::abs(off);
-        if (cfg_.max_offset_ticks > 0 && k > cfg_.max_offset_ticks) k = cfg_.max_offset_ticks;
-
-        ++limit_offset_count_;
-        limit_offset_abs_sum_ += k;
-        if (k < (int)limit_offset_hist_.size()) ++limit_offset_hist_[k];
-      }
-
-      int bucket = bucket_of(k);
-      ++lim_total_[bucket];
-
-      OrderId id = me_.submit_limit(Side::Buy, *e.px, e.qty, e.ts, fills);
-      if (ob_.index.count(id)) lim_bucket_by_id_[id] = bucket;
-      live_add_if_resting(id);
-      break;
+template <class Obs>
+void BasicSimulator<Obs>::execute(const SimEvent& e) {
+  // Every fill is handled once, as the engine produces it (record), plus
+  // the market order VWAP inputs
+  double   vsum = 0.0;
+  uint64_t qsum = 0;
+  auto fills = [&](const Fill& f) {
+    if constexpr (Obs::kEnabled) {
+      vsum += double(f.price) * f.qty;
+      qsum += f.qty;
     }
-    case EventType::LimitSell: {
-      int k = 0;
-      if (!ob_.bids.empty() && !ob_.asks.empty() && e.px) {
-        int bb  = ob_.best_bid();
-        int ba  = ob_.best_ask();
-        int mid = (bb + ba) / 2;
-        int off = mid - *e.px;          // positive if below mid
-        k = std::abs(off);
-        if (cfg_.max_offset_ticks > 0 && k > cfg_.max_offset_ticks) k = cfg_.max_offset_ticks;
-
-        ++limit_offset_count_;
-        limit_offset_abs_sum_ += k;
-        if (k < (int)limit_offset_hist_.size()) ++limit_offset_hist_[k];
-      }
+    record(f);
+  };
 
-      int bucket = bucket_of(k);
-      ++lim_total_[bucket];
+  // the log gets the event exactly as submitted, ahead of its fills
+  if (log_) log_->append(e);
 
-      OrderId id = me_.submit_limit(Side::Sell, *e.px, e.qty, e.ts, fills);
-      if (ob_.index.count(id)) lim_bucket_by_id_[id] = bucket;
-      live_add_if_resting(id);
-      break;
-    }
-    case EventType::MktBuy: {
-      int mid0 = mid_ticks();
-      me_.submit_market(Side::Buy, e.qty, e.ts, fills);
-      // VWAP of fills
-      double vsum = 0.0; uint64_t qsum = 0;
-      for (auto& f : fills) { vsum += double(f.price) * f.qty; qsum += f.qty; }
-      if (qsum) {
-        double vwap = vsum / double(qsum);
-        double slip = (vwap - mid0);      // buy pays above mid ⇒ positive
-        mo_buy_slip_ += slip * qsum;
-        mo_buy_qty_  += qsum;
-      }
+  switch (e.type) {
+    case EventType::LimitBuy:
+    case EventType::LimitSell: {
+      const Side s = e.type == EventType::LimitBuy ? Side::Buy : Side::Sell;
+      // the observer's tag (fill-by-distance bucket) rides on the resting
+      // order; the book keeps it in the resting (cancellable) set by itself
+      int8_t tag = -1;
+      if constexpr (Obs::kEnabled) tag = obs_.on_limit(s, e.px, ob_);
+      if (auction_) auction_->limit(s, e.px, e.qty, e.ts(), tag);
+      else          me_.submit_limit(s, e.px, e.qty, e.ts(), fills, tag);
       break;
     }
+    case EventType::MktBuy:
     case EventType::MktSell: {
-      int mid0 = mid_ticks();
-      me_.submit_market(Side::Sell, e.qty, e.ts, fills);
-      double vsum = 0.0; uint64_t qsum = 0;
-      for (auto& f : fills) { vsum += double(f.price) * f.qty; qsum += f.qty; }
-      if (qsum) {
-        double vwap = vsum / double(qsum);
-        double slip = (mid0 - vwap);      // sell receives below mid ⇒ positive
-        mo_sell_slip_ += slip * qsum;
-        mo_sell_qty_  += qsum;
-      }
+      const Side s = e.type == EventType::MktBuy ? Side::Buy : Side::Sell;
+      Price mid0 = 0;
+      if constexpr (Obs::kEnabled) mid0 = mid_ticks();
+      // waiting for the next auction, a market order has no fills (and so
+      // no slippage) yet
+      if (auction_) auction_->market(s, e.qty, e.ts());
+      else          me_.submit_market(s, e.qty, e.ts(), fills);
+      if constexpr (Obs::kEnabled) obs_.on_market(s, mid0, qsum, vsum);
       break;
     }
     case EventType::Cancel:
-      if (e.cancel_id) {
-        ob_.cancel(*e.cancel_id);     // <— MatchingEngine has no submit_cancel, cancel at book
-        live_remove(*e.cancel_id);
-      }
+      if (e.cancel_id) me_.submit_cancel(e.cancel_id);
       break;
   }
+  if (bounded_) trim_book(e);
+}
 
-  if (!fills.empty() && cfg_.log_trades) {
-    for (const auto& f : fills) {
-      std::cout << "TRADE t=" << f.ts
-                << " taker=" << f.taker_id
-                << " maker=" << f.maker_id
-                << " side="  << (f.taker_side == Side::Buy ? 'B' : 'S')
-                << " px="    << f.price
-                << " qty="   << f.qty
-                << "\n";
+/*
+Bounded runs: the book is cut back to its limits after every event, so
+it, its index and its node pool stop growing once they are reached.
+What goes is what is least likely to trade: first every level beyond
+max_depth_ticks from mid, then, while more than max_resting orders rest,
+the worst level of whichever side reaches farther from mid, newest order
+first. An evicted agent order is simply gone; the agent finds out when
+its cancel or replace is refused. Each eviction goes in the event log
+as a resolved Cancel of the evicted id, after the event that caused it
+and its fills, so a bounded run replays like any other.
+*/
+template <class Obs>
+void BasicSimulator<Obs>::trim_book(const SimEvent& cause) {
+  const Price mid = current_mid();
+  auto evict = [&](Side s) {
+    const OrderId id = ob_.evict_worst(s);
+    if (agents_) agent_orders_.erase(id);
+    ++evicted_;
+    if (log_) {
+      SimEvent c;
+      c.ts_ns     = cause.ts_ns;
+      c.cancel_id = id;
+      c.type      = EventType::Cancel;
+      c.side      = s;
+      c.regime    = cause.regime;
+      c.flags     = SimEvent::kResolved;
+      log_->append(c);
     }
+  };
+  if (const Price d = cfg_.max_depth_ticks) {
+    while (!ob_.bids.empty() && mid - ob_.bids.worst_price() > d) evict(Side::Buy);
+    while (!ob_.asks.empty() && ob_.asks.worst_price() - mid > d) evict(Side::Sell);
   }
-
-  for (const auto& f : fills) {
-    auto it = lim_bucket_by_id_.find(f.maker_id);
-    if (it != lim_bucket_by_id_.end()) {
-      ++lim_filled_[it->second];
-      // count "order ever got a fill" only once:
-      lim_bucket_by_id_.erase(it);
-    }
+  while (cfg_.max_resting && ob_.resting() > cfg_.max_resting) {
+    const bool bid_farther = ob_.asks.empty() ||
+        (!ob_.bids.empty() && mid - ob_.bids.worst_price() >= ob_.asks.worst_price() - mid);
+    evict(bid_farther ? Side::Buy : Side::Sell);
   }
-  // Makers that went to zero were removed from the book; also drop from live set
-  for (const auto& f : fills) live_remove(f.maker_id);
+}
 
-  // ---- Telemetry updates ----
-  ++n_events_;
-  switch (e.type) {
-    case EventType::LimitBuy:
-    case EventType::LimitSell: ++n_limits_;  break;
-    case EventType::MktBuy:
-    case EventType::MktSell:  ++n_markets_; break;
-    case EventType::Cancel:   ++n_cancels_; break;
+template <class Obs>
+void BasicSimulator<Obs>::record(const Fill& f) {
+  if constexpr (Obs::kEnabled) {
+    obs_.on_fill(f);
+    // a tag is reported filled once: clear it on the maker (if this
+    // fill finishes the maker, it leaves the book anyway), and in an
+    // auction on the taker, which may be either resting or collected
+    if (f.maker_tag >= 0) clear_tag(f.maker_id);
+    if (f.taker_tag >= 0) clear_tag(f.taker_id);
   }
+  if (log_) log_->append(f);
+
+  // trade log: a ring push here, formatting and I/O on the writer thread
+  if (trades_) trades_->log(f);
+
+  if (!agents_) return;
+  tape_.push_back(f);
+  if (taker_agent_ != kNoAgent)
+    own_fills_.push_back({f, taker_agent_, f.taker_id, f.taker_side, false, 0});
+  if (f.maker_tag == kAgentTag)
+    credit_resting(f, f.maker_id, f.taker_side == Side::Buy ? Side::Sell : Side::Buy);
+  if (f.taker_tag == kAgentTag)
+    credit_resting(f, f.taker_id, f.taker_side);
+}
+
+template <class Obs>
+void BasicSimulator<Obs>::clear_tag(OrderId id) {
+  if (RestingOrder* o = ob_.find(id)) o->tag = -1;
+  else if (auction_)
+    if (CallOrder* c = auction_->find(id)) c->tag = -1;
+}
+
+// A resting agent order traded: a maker fill for its owner
+template <class Obs>
+void BasicSimulator<Obs>::credit_resting(const Fill& f, OrderId id, Side side) {
+  const RestingOrder* m = ob_.find(id); // still resting, qty before this fill
+  const Qty leaves = m ? m->qty - f.qty : 0;
+  const OrderId owner = agent_orders_.find(id);
+  if (!owner) return;
+  own_fills_.push_back({f, AgentId(owner - 1), id, side, true, leaves});
+  if (leaves == 0) agent_orders_.erase(id);
+}
 
-  // Track spread (only if both sides exist)
-  if (!ob_.bids.empty() && !ob_.asks.empty()) {
-    int bb  = ob_.best_bid();
-    int ba  = ob_.best_ask();
-    int mid = (bb + ba) / 2;
+template <class Obs>
+AgentUpdate BasicSimulator<Obs>::agent_update(bool book_changed) const {
+  return AgentUpdate{
+    t_curr_, ob_,
+    ob_.bids.empty() ? Price(0) : ob_.best_bid(),
+    ob_.asks.empty() ? Price(0) : ob_.best_ask(),
+    book_changed ? std::span<const Fill>(tape_) : std::span<const Fill>(),
+    own_fills_, acks_, book_changed };
+}
+
+template <class Obs>
+void BasicSimulator<Obs>::start_agents() {
+  if (!agents_) return;
+  agents_->start(t_curr_);
+  const TimePoint next = agents_->next_timer();
+  if (next != EventScheduler::kNever) timers_.schedule(kAgentTimers, next);
+}
 
-    // existing spread metric
-    sum_spread_ += (ba - bb);
+/*
+Round 0 delivers the pending fills / acks and, after a flow event, the
+book update; each later round delivers what the previous round's
+intents caused. After kMaxAgentRounds the rest waits for the next
+notification, so agents trading against each other cannot stall the
+event loop.
+*/
+template <class Obs>
+void BasicSimulator<Obs>::notify_agents(bool book_changed) {
+  for (int round = 0; round < kMaxAgentRounds; ++round) {
+    const bool update = book_changed && round == 0;
+    if (!update && own_fills_.empty() && acks_.empty()) return;
+    agents_->notify(agent_update(update), intents_);
+    own_fills_.clear();
+    acks_.clear();
+    if (update) tape_.clear();
+    run_intents();
+  }
+}
 
-    // new mid stats
-    sum_mid_ += mid;
-    ++mid_samples_;
+// Intents sent while these run (none today: agents only send from hooks)
+// would queue behind them in intents_, so run a swapped-out batch
+template <class Obs>
+void BasicSimulator<Obs>::run_intents() {
+  running_.swap(intents_);
+  for (const QueuedIntent& q : running_) run_intent(q);
+  running_.clear();
+}
 
-    // max drawdown tracking
-    if (mid > peak_mid_) peak_mid_ = mid;
-    int dd = peak_mid_ - mid;
-    if (dd > max_drawdown_) max_drawdown_ = dd;
+template <class Obs>
+void BasicSimulator<Obs>::run_intent(const QueuedIntent& q) {
+  const OrderIntent& in = q.intent;
+  auto sink = [&](const Fill& f) { record(f); };
+  auto owns = [&](OrderId id) { return agent_orders_.find(id) == OrderId(q.agent) + 1; };
+  OrderAck ack{q.agent, in.id, in, 0, true};
+
+  ++agent_intents_;
+  taker_agent_ = q.agent;
+  switch (in.kind) {
+    case OrderIntent::Kind::Limit:
+      ack.id = me_.submit_limit(in.side, in.px, in.qty, in.tif, t_curr_, sink, kAgentTag);
+      break;
+    case OrderIntent::Kind::Market:
+      ack.id = me_.submit_market(in.side, in.qty, t_curr_, sink);
+      break;
+    case OrderIntent::Kind::Cancel:
+      ack.accepted = owns(in.id) && me_.submit_cancel(in.id);
+      if (ack.accepted) agent_orders_.erase(in.id);
+      break;
+    case OrderIntent::Kind::Replace:
+      ack.accepted = owns(in.id) && me_.submit_replace(in.id, in.px, in.qty, t_curr_, sink);
+      break;
   }
-  // If you have fills, count trades/volume and drop makers that went to zero
-  if (!fills.empty()) {
-    for (const auto& f : fills) {
-      ++n_trades_;
-      vol_traded_ += f.qty;
-      live_remove(f.maker_id);
-    }
+  taker_agent_ = kNoAgent;
+
+  // what rests under the id now: a new limit joins the agent's orders, a
+  // replace that traded out on the way in leaves them
+  const bool placed = in.kind == OrderIntent::Kind::Limit ||
+                      (in.kind == OrderIntent::Kind::Replace && ack.accepted);
+  if (const RestingOrder* o = placed ? ob_.find(ack.id) : nullptr) {
+    ack.resting = o->qty;
+    if (in.kind == OrderIntent::Kind::Limit) agent_orders_.insert(ack.id, OrderId(q.agent) + 1);
+  } else if (placed && in.kind == OrderIntent::Kind::Replace) {
+    agent_orders_.erase(ack.id);
   }
+  acks_.push_back(ack);
 }
 
+template <class Obs>
+AgentStats BasicSimulator<Obs>::agent_stats() const {
+  return agents_ ? agents_->stats(current_mid()) : AgentStats{};
+}
 
-void Simulator::run() {
-  std::cout << "[sim] start (max_events=" << cfg_.max_events << ")\n";
+template <class Obs>
+Checkpoint BasicSimulator<Obs>::checkpoint() const {
+  if (agents_) throw std::logic_error("Simulator::checkpoint: agents are not checkpointed");
+  CheckpointHeader h{};
+  h.seed   = cfg_.seed;
+  h.stream = cfg_.stream;
+  h.rng    = cfg_.rng;
+  h.regime = regime_;
+  h.events = events_before_ + n_events_;
+  h.t      = t_curr_;
+  h.gen    = gen_.state();
+  return Checkpoint(h, ob_, me_);
+}
 
-  for (size_t i = 0; i < cfg_.max_events; ++i) {
-    SimEvent e = next_event();
-    execute(e);
+template <class Obs>
+void BasicSimulator<Obs>::restore(const Checkpoint& ck, Resume how) {
+  if (n_events_ || ob_.resting()) throw std::logic_error("Simulator::restore: this Simulator has already run");
+  const CheckpointHeader& h = ck.header();
+  if (how == Resume::Continue && (h.seed != cfg_.seed || h.stream != cfg_.stream || h.rng != cfg_.rng))
+    throw std::invalid_argument("Simulator::restore: Resume::Continue needs the checkpoint's seed, stream and rng");
+
+  ck.restore(ob_, me_);
+  if (how == Resume::Continue) gen_.restore(h.gen);
+  else                         gen_.start_at(h.t, h.regime);
+  t_curr_        = h.t;
+  regime_        = h.regime;
+  events_before_ = h.events;
+
+  // windows (and auctions) count from the checkpoint's time, not from 0
+  if (timers_.pending(kMetricsWindow)) timers_.schedule(kMetricsWindow, h.t + cfg_.metrics_window);
+  if (timers_.pending(kAuction))       timers_.schedule(kAuction, h.t + cfg_.auction_interval);
+}
+
+template <class Obs>
+void BasicSimulator<Obs>::account(const SimEvent& e) {
+  ++n_events_;
+  if constexpr (Obs::kEnabled) obs_.on_event(e, ob_);
+}
+
+/*
+The event loop proper. run() wraps it with the heartbeat and the printed
+report; simulate() runs it silently and hands back the numbers, which is
+what sweeps want (many runs at once, nothing shared on stdout).
+*/
+template <class Obs>
+void BasicSimulator<Obs>::loop(bool progress) {
+  if constexpr (Obs::kEnabled) obs_.on_start(t_curr_);
+  start_agents();
+  if (cfg_.pipeline) {
+    switch (cfg_.pipeline_wait) {
+      case WaitStrategy::Spin:  loop_pipelined<WaitStrategy::Spin>(progress);  break;
+      case WaitStrategy::Yield: loop_pipelined<WaitStrategy::Yield>(progress); break;
+      case WaitStrategy::Park:  loop_pipelined<WaitStrategy::Park>(progress);  break;
+    }
+  } else {
+    loop_serial(progress);
+  }
+  if (log_) log_->close(); // surface write errors here, not in a destructor
+  if (trades_) trades_->close();
+  if (snaps_) snaps_->close();
+}
 
-    // heartbeat every 10k events so you know it's alive
-    if (((i + 1) % 10000) == 0) {
-      std::cout << "[sim] processed " << (i + 1) << " events\n";
+template <class Obs>
+void BasicSimulator<Obs>::loop_serial(bool progress) {
+  // Draws for a whole batch first (book-independent), then resolve and
+  // execute the rows one by one against the book
+  const size_t batch = cfg_.gen_batch ? cfg_.gen_batch : 1;
+  for (size_t i = 0, j = 0; i < cfg_.max_events; ++i, ++j) {
+    if (j == batch_.n) {
+#if LOB_LATENCY
+      timed_fill(gen_, batch_, std::min(batch, cfg_.max_events - i));
+#else
+      gen_.fill(batch_, std::min(batch, cfg_.max_events - i));
+#endif
+      j = 0;
     }
+    step(i, batch_.row(j), progress);
+  }
+}
 
-    // snapshots
-    if (cfg_.snapshot_every && ((i + 1) % cfg_.snapshot_every == 0)) {
-      std::cout << "\n--- snapshot @" << (i + 1) << " events ---\n";
+/*
+Two-thread version of the same loop. The split is the one the generator
+already draws along:
+
+  producer thread: gen_.fill() -> unresolved SimEvents -> SPSC ring
+  this thread:     ring -> resolve() (mid, crossing, cancel target) -> execute()
+
+Everything that reads the book (decide_limit_price, sample_live) stays on
+this side, so the producer never looks at book state and the run is
+draw-for-draw the same as loop()'s, whatever the timing between threads.
+While the pipeline runs, gen_ belongs to the producer.
+*/
+template <class Obs>
+template <WaitStrategy W>
+void BasicSimulator<Obs>::loop_pipelined(bool progress) {
+  const size_t n = cfg_.max_events;
+  SpscRing<SimEvent, W> ring(cfg_.pipeline_ring);
+
+  std::thread producer([&] {
+    const size_t batch = cfg_.gen_batch ? cfg_.gen_batch : 1;
+    EventBatch b;
+    for (size_t done = 0; done < n; ) {
+      const size_t m = std::min(batch, n - done);
+#if LOB_LATENCY
+      timed_fill(gen_, b, m);   // only this thread touches stage[Generate]
+#else
+      gen_.fill(b, m);
+#endif
+      for (size_t j = 0; j < m; ++j) ring.push(b.row(j));
+      done += m;
     }
+  });
+
+  SimEvent d;
+  size_t i = 0;
+  try {
+    for (; i < n; ++i) {
+      ring.pop(d);
+      step(i, d, progress);
+    }
+  } catch (...) {
+    // let the producer finish (it blocks on a full ring) before unwinding
+    for (++i; i < n; ++i) ring.pop(d);
+    producer.join();
+    throw;
+  }
+  producer.join();
+}
+
+// Event i of the run: resolve + execute, then the progress output
+template <class Obs>
+void BasicSimulator<Obs>::step(size_t i, SimEvent e, bool progress) {
+  // arena allocations over the second half of the run = steady state
+  if (i == cfg_.max_events / 2) {
+    allocs_at_half_ = ob_.arena.allocations();
+    bytes_at_half_  = ob_.arena.bytes_live();
+  }
+#if LOB_LATENCY
+  if (lat_.sampled(i)) {
+    timed(e);
+  } else
+#endif
+  {
+    resolve(e);
+    execute(e);
+    account(e);
+  }
+  if (agents_) notify_agents(true);
+  const bool snap = cfg_.snapshot_every && ((i + 1) % cfg_.snapshot_every == 0);
+  if (snap && snaps_) snaps_->capture(ob_, i + 1, e.ts_ns);
+  if (!progress) return;
+
+  // heartbeat every 10k events so you know it's alive
+  if (((i + 1) % 10000) == 0) {
+    std::cout << "[sim] processed " << (i + 1) << " events\n";
   }
 
-  double avg_mid     = (mid_samples_ ? (sum_mid_ / double(mid_samples_)) : 0.0);
-  double slip_buy_vw = (mo_buy_qty_  ? (mo_buy_slip_  / double(mo_buy_qty_))  : 0.0);
-  double slip_sell_vw= (mo_sell_qty_ ? (mo_sell_slip_ / double(mo_sell_qty_)) : 0.0);
+  // snapshots
+  if (snap && !snaps_) {
+    std::cout << "\n--- snapshot @" << (i + 1) << " events ---\n";
+  }
+}
+
+template <class Obs>
+void BasicSimulator<Obs>::apply(SimEvent e) {
+  resolve(e);
+  execute(e);
+  account(e);
+  if (agents_) notify_agents(true);
+}
+
+#if LOB_LATENCY
+template <class Obs>
+void BasicSimulator<Obs>::timed(SimEvent& e) {
+  const uint64_t t0 = lat_now();
+  resolve(e);
+  const uint64_t t1 = lat_now();
+  execute(e);
+  const uint64_t t2 = lat_now();
+  account(e);
+  const uint64_t t3 = lat_now();
+  lat_.stage[size_t(Stage::Resolve)].record(t1 - t0);
+  lat_.stage[size_t(Stage::Match)].record(t2 - t1);
+  lat_.stage[size_t(Stage::Telemetry)].record(t3 - t2);
+  lat_.by_type[size_t(e.type)].record(t3 - t0);  // as resolved (a Cancel may become a limit)
+}
+
+template <class Obs>
+void BasicSimulator<Obs>::timed_fill(EventGenerator& g, EventBatch& b, std::size_t n) {
+  const uint64_t t0 = lat_now();
+  g.fill(b, n);
+  if (n) lat_.stage[size_t(Stage::Generate)].record((lat_now() - t0) / n, n);
+}
+#endif
+
+template <class Obs>
+SimStats BasicSimulator<Obs>::stats() const {
+  SimStats st;
+  st.seed   = cfg_.seed;
+  st.events = n_events_;
+  if constexpr (Obs::kEnabled) obs_.report(st);
+  return st;
+}
+
+template <class Obs>
+SimStats BasicSimulator<Obs>::simulate() {
+  loop(false);
+  return stats();
+}
+
+template <class Obs>
+void BasicSimulator<Obs>::run() {
+  std::cout << "[sim] start (max_events=" << cfg_.max_events << ")\n";
+  loop(true);
+
+  const SimStats st  = stats();
+  double avg_mid     = st.avg_mid;
+  double slip_buy_vw = st.slip_buy_vw;
+  double slip_sell_vw= st.slip_sell_vw;
 
   // bucket ratios
   auto pct = [](uint64_t num, uint64_t den)->double {
@@ -345,28 +591,88 @@ void Simulator::run() {
   };
 
   std::cout << "avg_mid=" << avg_mid
-            << " max_drawdown_ticks=" << max_drawdown_
+            << " max_drawdown_ticks=" << st.max_drawdown
             << " mo_slip_buy_vw=" << slip_buy_vw
             << " mo_slip_sell_vw=" << slip_sell_vw
             << "\n";
+  std::cout << "sim_seconds=" << st.sim_seconds
+            << " events_per_sim_sec=" << st.events_per_sim_sec
+            << " windows=" << st.windows
+            << " window_eps_min=" << st.window_eps_min
+            << " window_eps_max=" << st.window_eps_max
+            << " window_eps_sd=" << st.window_eps_sd
+            << "\n";
+  std::cout << "spread_sd=" << st.spread_sd
+            << " spread_p50=" << st.spread_p50
+            << " spread_p99=" << st.spread_p99
+            << " tw_spread=" << st.tw_spread
+            << "\n";
+
+  const uint64_t allocs = ob_.arena.allocations();
+  const size_t   steady = cfg_.max_events - cfg_.max_events / 2;
+  std::cout << "arena_allocs=" << allocs
+            << " arena_peak_bytes=" << ob_.arena.bytes_peak()
+            << " allocs_per_event=" << (n_events_ ? double(allocs) / double(n_events_) : 0.0)
+            << " steady_allocs_per_event="
+            << (steady ? double(allocs - allocs_at_half_) / double(steady) : 0.0)
+            << "\n";
+  // book memory growth over the second half: ~0 once a bounded run fills up
+  const uint64_t bytes = ob_.arena.bytes_live();
+  std::cout << "memory resting=" << ob_.resting()
+            << " book_bytes=" << bytes
+            << " steady_growth_bytes=" << int64_t(bytes - bytes_at_half_)
+            << " evicted=" << evicted_
+            << "\n";
+
+  if (trades_) {
+    std::cout << "trade_log written=" << trades_->written()
+              << " dropped=" << trades_->dropped() << "\n";
+  }
+  if (agents_) {
+    const AgentStats a = agent_stats();
+    std::cout << "agents n=" << a.agents
+              << " intents=" << agent_intents_
+              << " fills=" << a.fills
+              << " vol=" << a.volume
+              << " net_position=" << a.position
+              << " pnl_ticks=" << a.pnl << "\n";
+  }
+  if (auction_) {
+    std::cout << "auctions n=" << auctions_
+              << " traded=" << auctions_traded_
+              << " vol=" << auction_vol_
+              << " collected=" << auction_->collected() << "\n";
+  }
+  if (snaps_) {
+    std::cout << "l2_snapshots frames=" << snaps_->frames()
+              << " full=" << snaps_->full_frames()
+              << " rows=" << snaps_->rows() << "\n";
+  }
 
   static const char* BKT[5] = {"0","1-2","3-5","6-10",">10"};
   for (int i = 0; i < 5; ++i) {
     std::cout << "limit_fill_ratio_bucket[" << BKT[i] << "] "
-              << lim_filled_[i] << "/" << lim_total_[i]
-              << " (" << pct(lim_filled_[i], lim_total_[i]) << "%)\n";
+              << st.lim_filled[i] << "/" << st.lim_total[i]
+              << " (" << pct(st.lim_filled[i], st.lim_total[i]) << "%)\n";
   }
 
   // final summary
-  double avg_spread = n_events_ ? (static_cast<double>(sum_spread_) / n_events_) : 0.0;
+  double avg_spread = st.avg_spread;
   std::cout << "\n=== SIM DONE ===\n"
-            << "events="   << n_events_
-            << " limits="  << n_limits_
-            << " markets=" << n_markets_
-            << " cancels=" << n_cancels_
-            << " trades="  << n_trades_
-            << " vol="     << vol_traded_
+            << "events="   << st.events
+            << " limits="  << st.limits
+            << " markets=" << st.markets
+            << " cancels=" << st.cancels
+            << " trades="  << st.trades
+            << " vol="     << st.vol
             << " avg_spread=" << avg_spread
             << "\n";
+#if LOB_LATENCY
+  static const char* kTypeNames[LatencyProfile::kTypes] = {"LimitBuy", "LimitSell", "MktBuy", "MktSell", "Cancel"};
+  lat_.print(std::cout, kTypeNames);
+#endif
 }
-  
\ No newline at end of file
+  
+
+template class BasicSimulator<SimTelemetry>;
+template class BasicSimulator<NoTelemetry>;
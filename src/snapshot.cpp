@@ -0,0 +1,142 @@
+#include "snapshot.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+static std::runtime_error io_error(const std::string& what, const std::string& path) {
+  return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+L2Snapshotter::L2Snapshotter(const std::string& path, std::size_t depth, uint32_t full_every,
+                             std::size_t buffer_bytes)
+  : depth_(depth), full_every_(full_every ? full_every : 1), path_(path) {
+  if (depth_ == 0) throw std::invalid_argument("L2Snapshotter: depth must be > 0");
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) throw io_error("cannot create", path);
+  buf_.resize(std::max<std::size_t>(buffer_bytes, 4096));
+
+  const LogHeader h = LogHeader::make(kL2Magic, kRowBytes);
+  std::memcpy(buf_.data(), &h, sizeof h);
+  used_ = sizeof h;
+}
+
+L2Snapshotter::~L2Snapshotter() {
+  try { close(); } catch (...) {}
+}
+
+/*
+Current top-N view of side S, straight from the level aggregates. A side
+the book has not marked dirty since the last frame cannot have changed,
+so its previous view is kept without walking the levels at all.
+*/
+template <Side S>
+void L2Snapshotter::view(const OrderBook& ob, bool changed, std::vector<Level>& out) {
+  if (!changed) { out = view_[int(S)]; return; }
+  ob.depth(S, depth_, out);
+}
+
+// Delta rows for one side: merge the two best-first views
+template <Side S>
+void L2Snapshotter::diff(const std::vector<Level>& prev, const std::vector<Level>& cur) {
+  auto p = prev.begin();
+  auto c = cur.begin();
+  while (p != prev.end() || c != cur.end()) {
+    if (c == cur.end() || (p != prev.end() && SideTraits<S>::better(p->px, c->px))) {
+      row(S, Level{p->px, 0, 0});                 // left the view
+      ++p;
+    } else if (p == prev.end() || SideTraits<S>::better(c->px, p->px)) {
+      row(S, *c);                                 // came into view
+      ++c;
+    } else {
+      if (!(*p == *c)) row(S, *c);                // same price, changed
+      ++p; ++c;
+    }
+  }
+}
+
+void L2Snapshotter::row(Side s, const Level& l) {
+  px_.push_back(l.px);
+  qty_.push_back(l.qty);
+  count_.push_back(l.count);
+  side_.push_back(uint8_t(s));
+}
+
+void L2Snapshotter::capture(OrderBook& ob, uint64_t seq, int64_t ts_ns) {
+  const bool full = frames_ % full_every_ == 0;
+
+  // Before the first frame nothing is cached, so tracking can start here
+  const bool bid_changed = frames_ == 0 || !ob.dirty(Side::Buy).empty();
+  const bool ask_changed = frames_ == 0 || !ob.dirty(Side::Sell).empty();
+  ob.track_dirty(true);
+  ob.clear_dirty();
+
+  view<Side::Buy>(ob, bid_changed, next_[int(Side::Buy)]);
+  view<Side::Sell>(ob, ask_changed, next_[int(Side::Sell)]);
+
+  px_.clear(); qty_.clear(); count_.clear(); side_.clear();
+  if (full) {
+    for (const Level& l : next_[int(Side::Buy)])  row(Side::Buy, l);
+    for (const Level& l : next_[int(Side::Sell)]) row(Side::Sell, l);
+  } else {
+    diff<Side::Buy>(view_[int(Side::Buy)], next_[int(Side::Buy)]);
+    diff<Side::Sell>(view_[int(Side::Sell)], next_[int(Side::Sell)]);
+  }
+  view_[0].swap(next_[0]);
+  view_[1].swap(next_[1]);
+
+  write_frame(seq, ts_ns, full ? FrameKind::Full : FrameKind::Delta);
+  ++frames_;
+  if (full) ++full_;
+}
+
+void L2Snapshotter::write_frame(uint64_t seq, int64_t ts_ns, FrameKind kind) {
+  const std::size_t n = px_.size();
+  FrameHeader h;
+  h.seq   = seq;
+  h.ts_ns = ts_ns;
+  h.rows  = uint32_t(n);
+  h.kind  = kind;
+  put(&h, sizeof h);
+  put(px_.data(),    n * sizeof(int64_t));
+  put(qty_.data(),   n * sizeof(int64_t));
+  put(count_.data(), n * sizeof(uint32_t));
+  put(side_.data(),  n * sizeof(uint8_t));
+  static constexpr char zeros[8] = {};
+  const std::size_t tail = (n * (sizeof(uint32_t) + sizeof(uint8_t))) % 8;
+  if (tail) put(zeros, 8 - tail);
+  rows_ += n;
+}
+
+void L2Snapshotter::put(const void* p, std::size_t n) {
+  const char* c = static_cast<const char*>(p);
+  while (n) {
+    if (used_ == buf_.size()) flush();
+    const std::size_t k = std::min(n, buf_.size() - used_);
+    std::memcpy(buf_.data() + used_, c, k);
+    used_ += k; c += k; n -= k;
+  }
+}
+
+void L2Snapshotter::flush() {
+  const char* p = buf_.data();
+  std::size_t left = used_;
+  while (left) {
+    const ssize_t n = ::write(fd_, p, left);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw io_error("write failed on", path_);
+    }
+    p += n;
+    left -= std::size_t(n);
+  }
+  used_ = 0;
+}
+
+void L2Snapshotter::close() {
+  if (fd_ < 0) return;
+  flush();
+  if (::close(fd_) != 0) { fd_ = -1; throw io_error("close failed on", path_); }
+  fd_ = -1;
+}
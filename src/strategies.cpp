@@ -0,0 +1,77 @@
+#include "strategies.hpp"
+#include <cstdlib>
+
+QuotingMaker::QuotingMaker(Qty size, Price half_spread, Price requote, int64_t max_position)
+  : size_(size), half_spread_(half_spread), requote_(requote > 0 ? requote : 1),
+    max_position_(max_position) {
+  if (size_ <= 0) throw std::invalid_argument("QuotingMaker: size must be > 0");
+  if (half_spread_ < 0) throw std::invalid_argument("QuotingMaker: half_spread must be >= 0");
+}
+
+// One side: place if nothing rests, move if mid has drifted, pull if the
+// inventory limit says so. Nothing is sent while an earlier intent waits
+// for its ack.
+void QuotingMaker::quote(Side s, Quote& q, Price target, bool allowed, Intents& out) {
+  if (q.pending) return;
+  if (!allowed || target <= 0) {
+    if (q.id) { out.cancel(q.id); q.pending = true; }
+    return;
+  }
+  if (!q.id) {
+    out.limit(s, target, size_);
+    q.px = target;
+    q.pending = true;
+  } else if (std::abs(target - q.px) >= requote_) {
+    out.replace(q.id, target, size_);
+    q.px = target;
+    q.pending = true;
+  }
+}
+
+void QuotingMaker::on_book_update(const AgentUpdate& u, Intents& out) {
+  if (!u.two_sided()) return;
+  const Price mid = u.mid();
+  quote(Side::Buy,  bid_, mid - half_spread_, position() <  max_position_, out);
+  quote(Side::Sell, ask_, mid + half_spread_, position() > -max_position_, out);
+}
+
+void QuotingMaker::on_fill(const AgentFill& f, Intents&) {
+  if (!f.maker || f.leaves > 0) return;
+  Quote& q = f.side == Side::Buy ? bid_ : ask_;
+  // filled out: requote on the next update (a pending replace or cancel
+  // of it will come back rejected and clear it instead)
+  if (!q.pending && q.id == f.order()) q.id = 0;
+}
+
+void QuotingMaker::on_order_ack(const OrderAck& k, Intents&) {
+  const bool buy = k.intent.kind == OrderIntent::Kind::Limit ? k.intent.side == Side::Buy
+                                                             : k.id == bid_.id;
+  Quote& q = buy ? bid_ : ask_;
+  q.pending = false;
+  switch (k.intent.kind) {
+    case OrderIntent::Kind::Limit:
+    case OrderIntent::Kind::Replace:
+      // a quote priced through the book trades on arrival; whatever is
+      // left rests under the acked id
+      q.id = k.accepted && k.resting > 0 ? k.id : 0;
+      break;
+    case OrderIntent::Kind::Cancel:
+      q.id = 0;
+      break;
+    case OrderIntent::Kind::Market:
+      break;
+  }
+}
+
+TwapExecutor::TwapExecutor(Side side, Qty total, Qty slice, TimePoint interval)
+  : side_(side), total_(total), slice_(slice), interval_(interval) {
+  if (total_ < 0 || slice_ <= 0) throw std::invalid_argument("TwapExecutor: need total >= 0, slice > 0");
+  if (!(interval_ > 0.0)) throw std::invalid_argument("TwapExecutor: interval must be > 0");
+}
+
+void TwapExecutor::on_timer(const AgentUpdate& u, Intents& out) {
+  if (sent_ >= total_ || !(side_ == Side::Buy ? u.best_ask > 0 : u.best_bid > 0)) return;
+  const Qty q = std::min(slice_, total_ - sent_);
+  out.market(side_, q);
+  sent_ += q;
+}
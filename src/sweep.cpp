@@ -0,0 +1,197 @@
+#include "sweep.hpp"
+#include "sim.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iomanip>
+#include <ostream>
+#include <thread>
+
+/*
+Work stealing over a fixed job list. A worker's remaining jobs are a
+range [lo, hi) packed into one 64-bit atomic (lo in the low half, hi in
+the high half), so both ends can be updated with a single CAS and no
+locks:
+  - the owner takes jobs from the front (lo + 1),
+  - a thief takes the back half (hi -> mid) and makes [mid, hi) its own.
+Only the owner ever stores to its own range, and only while it is empty,
+which nobody else touches. Each range sits on its own cache line so
+owners popping jobs don't bounce each other's lines.
+*/
+namespace {
+
+struct alignas(64) JobRange {
+  std::atomic<uint64_t> v{0};
+};
+
+constexpr uint64_t pack(uint32_t lo, uint32_t hi) { return uint64_t(lo) | (uint64_t(hi) << 32); }
+constexpr uint32_t lo_of(uint64_t v) { return uint32_t(v); }
+constexpr uint32_t hi_of(uint64_t v) { return uint32_t(v >> 32); }
+
+bool pop_front(JobRange& r, std::size_t& job) {
+  uint64_t v = r.v.load(std::memory_order_acquire);
+  while (lo_of(v) < hi_of(v)) {
+    if (r.v.compare_exchange_weak(v, pack(lo_of(v) + 1, hi_of(v)), std::memory_order_acq_rel)) {
+      job = lo_of(v);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool steal_half(JobRange& victim, uint32_t& lo, uint32_t& hi) {
+  uint64_t v = victim.v.load(std::memory_order_acquire);
+  while (lo_of(v) < hi_of(v)) {
+    const uint32_t mid = lo_of(v) + (hi_of(v) - lo_of(v)) / 2; // victim keeps [lo, mid)
+    if (victim.v.compare_exchange_weak(v, pack(lo_of(v), mid), std::memory_order_acq_rel)) {
+      lo = mid;
+      hi = hi_of(v);
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+void parallel_for_stealing(std::size_t n, unsigned threads,
+                           const std::function<void(std::size_t)>& f) {
+  if (n == 0) return;
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = unsigned(std::min<std::size_t>(threads, n));
+  if (threads == 1) {
+    for (std::size_t i = 0; i < n; ++i) f(i);
+    return;
+  }
+
+  std::vector<JobRange> ranges(threads);
+  for (unsigned w = 0; w < threads; ++w)
+    ranges[w].v.store(pack(uint32_t(n * w / threads), uint32_t(n * (w + 1) / threads)));
+
+  // an exception must not escape a std::thread: each worker parks its own
+  // and raises `failed` so the others stop taking jobs
+  std::vector<std::exception_ptr> errors(threads);
+  std::atomic<bool> failed{false};
+  auto work = [&](unsigned self) {
+    for (;;) {
+      std::size_t job;
+      while (!failed.load(std::memory_order_relaxed) && pop_front(ranges[self], job)) f(job);
+      if (failed.load(std::memory_order_relaxed)) return;
+
+      // out of work: scan the others once, starting next door
+      bool stole = false;
+      for (unsigned k = 1; k < threads && !stole; ++k) {
+        uint32_t lo, hi;
+        if (steal_half(ranges[(self + k) % threads], lo, hi)) {
+          ranges[self].v.store(pack(lo, hi), std::memory_order_release);
+          stole = true;
+        }
+      }
+      // a slice in flight between a thief's CAS and its store looks empty
+      // here; that's fine, the thief runs it
+      if (!stole) return;
+    }
+  };
+  auto worker = [&](unsigned self) {
+    try {
+      work(self);
+    } catch (...) {
+      errors[self] = std::current_exception();
+      failed.store(true, std::memory_order_relaxed);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (unsigned w = 1; w < threads; ++w) pool.emplace_back(worker, w);
+  worker(0);
+  for (auto& t : pool) t.join();
+  for (const auto& e : errors)
+    if (e) std::rethrow_exception(e);
+}
+
+std::vector<SimStats> run_many(const std::vector<SimConfig>& cfgs, unsigned threads,
+                               const Checkpoint* warm) {
+  std::vector<SimStats> out(cfgs.size());
+  parallel_for_stealing(cfgs.size(), threads, [&](std::size_t i) {
+    Simulator sim(cfgs[i]);
+    if (warm) sim.restore(*warm, Resume::Fork);
+    out[i] = sim.simulate();
+  });
+  return out;
+}
+
+std::vector<SweepResult> run_sweep(const std::vector<SweepPoint>& grid,
+                                   const std::vector<uint64_t>& seeds,
+                                   unsigned threads,
+                                   const Checkpoint* warm) {
+  // point-major, so each worker's initial slice covers whole points
+  std::vector<SimConfig> cfgs;
+  cfgs.reserve(grid.size() * seeds.size());
+  for (const auto& p : grid)
+    for (uint64_t s : seeds) {
+      cfgs.push_back(p.cfg);
+      cfgs.back().seed = s;
+    }
+
+  const std::vector<SimStats> runs = run_many(cfgs, threads, warm);
+
+  std::vector<SweepResult> out(grid.size());
+  for (std::size_t g = 0; g < grid.size(); ++g) {
+    auto first = runs.begin() + std::ptrdiff_t(g * seeds.size());
+    out[g].label = grid[g].label;
+    out[g].runs.assign(first, first + std::ptrdiff_t(seeds.size()));
+    out[g].summary = summarize(out[g].runs.data(), out[g].runs.size());
+  }
+  return out;
+}
+
+void print_sweep(std::ostream& os, const std::vector<SweepResult>& results) {
+  auto ms = [&](const char* name, const MetricSummary& m) {
+    os << "  " << std::left << std::setw(18) << name << std::right
+       << " mean=" << m.mean << " sd=" << m.sd << " ci95=+/-" << m.ci95 << "\n";
+  };
+  static const char* BKT[5] = {"0","1-2","3-5","6-10",">10"};
+
+  for (const auto& r : results) {
+    const StatsSummary& s = r.summary;
+    os << "\n--- " << r.label << " (" << s.runs << " seeds) ---\n";
+    ms("avg_spread", s.avg_spread);
+    ms("mo_slip_buy_vw", s.slip_buy_vw);
+    ms("mo_slip_sell_vw", s.slip_sell_vw);
+    ms("max_drawdown", s.max_drawdown);
+    ms("trades", s.trades);
+    for (int b = 0; b < 5; ++b)
+      ms((std::string("fill_ratio[") + BKT[b] + "]").c_str(), s.fill_ratio[b]);
+  }
+}
+
+SimConfig m3_sweep_base(BookBackend backend, RngKind rng) {
+  SimConfig sc{};
+  sc.seed             = 42;
+  sc.max_events       = 50000;      // keep small for quick sweeps
+  sc.snapshot_every   = 0;          // disable snapshots for speed
+  sc.regime.p_LL      = 0.995;
+  sc.regime.p_HH      = 0.990;
+  sc.regime.low.lambda  = 800.0;
+  sc.regime.high.lambda = 2000.0;
+  sc.regime.low.mix.p_limit_buy  = 0.35;
+  sc.regime.low.mix.p_limit_sell = 0.35;
+  sc.regime.low.mix.p_mkt_buy    = 0.10;
+  sc.regime.low.mix.p_mkt_sell   = 0.10;
+  sc.regime.high.mix.p_limit_buy  = 0.28;
+  sc.regime.high.mix.p_limit_sell = 0.28;
+  sc.regime.high.mix.p_mkt_buy    = 0.18;
+  sc.regime.high.mix.p_mkt_sell   = 0.18;
+  sc.mean_limit_qty   = 50.0;
+  sc.mean_market_qty  = 50.0;
+  sc.initial_mid_ticks= 10000;
+  sc.min_price_ticks  = 1;
+  sc.max_offset_ticks = 20;
+  sc.geolap_alpha     = 0.15;
+  sc.keep_cross_prob  = 0.15;
+  sc.log_trades       = false;
+  sc.book_backend     = backend;
+  sc.rng              = rng;
+  return sc;
+}
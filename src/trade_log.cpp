@@ -0,0 +1,120 @@
+#include "trade_log.hpp"
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+TradeLogger::TradeLogger(const std::string& path, TradeLogFormat fmt, Backpressure bp,
+                         std::size_t ring_capacity)
+  : ring_(ring_capacity), fmt_(fmt), bp_(bp), path_(path.empty() ? "<stdout>" : path) {
+  if (path.empty()) {
+    fd_ = STDOUT_FILENO;
+  } else {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) throw std::runtime_error("cannot create " + path + ": " + std::strerror(errno));
+    own_fd_ = true;
+  }
+  out_.resize(1 << 20);
+  if (fmt_ == TradeLogFormat::Binary) {
+    const LogHeader h = LogHeader::make(kFillMagic, sizeof(FillRecord));
+    std::memcpy(out_.data(), &h, sizeof h);
+    used_ = sizeof h;
+  }
+  writer_ = std::thread([this] { run(); });
+}
+
+TradeLogger::~TradeLogger() {
+  try { close(); } catch (...) {}
+}
+
+void TradeLogger::close() {
+  if (closed_) return;
+  closed_ = true;
+  stop_.store(true, std::memory_order_release);
+  writer_.join();
+  if (own_fd_ && ::close(fd_) != 0 && !error_)
+    error_ = std::make_exception_ptr(std::runtime_error("close failed on " + path_));
+  if (error_) std::rethrow_exception(error_);
+}
+
+/*
+Writer loop: take whatever is queued (up to kChunk), format it, and write
+when the buffer is nearly full. When the ring is empty, flush what we have
+and nap briefly; latency doesn't matter here, so the producer never has
+to pay for waking us. stop_ is only honoured once the ring is empty.
+*/
+void TradeLogger::run() {
+  std::vector<FillRecord> chunk(kChunk);
+  for (;;) {
+    const std::size_t n = ring_.try_pop_bulk(chunk.data(), kChunk);
+    if (n) {
+      if (!error_) {
+        try { emit(chunk.data(), n); } catch (...) { error_ = std::current_exception(); }
+      }
+      written_.fetch_add(error_ ? 0 : n, std::memory_order_relaxed);
+      continue;
+    }
+    if (stop_.load(std::memory_order_acquire)) {
+      // producer is done: one last look, then flush and leave
+      if (ring_.try_pop_bulk(chunk.data(), kChunk)) continue;
+      break;
+    }
+    if (!error_) {
+      try { flush(); } catch (...) { error_ = std::current_exception(); }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  if (!error_) {
+    try { flush(); } catch (...) { error_ = std::current_exception(); }
+  }
+}
+
+void TradeLogger::emit(const FillRecord* r, std::size_t n) {
+  if (fmt_ == TradeLogFormat::Binary) {
+    const std::size_t bytes = n * sizeof(FillRecord);
+    if (used_ + bytes > out_.size()) flush();
+    std::memcpy(out_.data() + used_, r, bytes);
+    used_ += bytes;
+    return;
+  }
+
+  constexpr std::size_t kMaxLine = 160;
+  for (std::size_t k = 0; k < n; ++k) {
+    if (used_ + kMaxLine > out_.size()) flush();
+    char* p = out_.data() + used_;
+    char* const end = out_.data() + out_.size();
+    // same fields and order as the old inline std::cout trade log
+    p += std::snprintf(p, std::size_t(end - p), "TRADE t=%g taker=", double(r[k].ts_ns) * 1e-9);
+    p = std::to_chars(p, end, r[k].taker_id).ptr;
+    std::memcpy(p, " maker=", 7); p += 7;
+    p = std::to_chars(p, end, r[k].maker_id).ptr;
+    std::memcpy(p, " side=", 6); p += 6;
+    *p++ = r[k].taker_side == Side::Buy ? 'B' : 'S';
+    std::memcpy(p, " px=", 4); p += 4;
+    p = std::to_chars(p, end, r[k].price).ptr;
+    std::memcpy(p, " qty=", 5); p += 5;
+    p = std::to_chars(p, end, r[k].qty).ptr;
+    *p++ = '\n';
+    used_ = std::size_t(p - out_.data());
+  }
+}
+
+void TradeLogger::flush() {
+  const char* p = out_.data();
+  std::size_t left = used_;
+  while (left) {
+    const ssize_t w = ::write(fd_, p, left);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      used_ = 0;
+      throw std::runtime_error("write failed on " + path_ + ": " + std::strerror(errno));
+    }
+    p += w;
+    left -= std::size_t(w);
+  }
+  used_ = 0;
+}